@@ -9,7 +9,7 @@
  * This example generates a dump of a file.
  * If the program is called with the -x flag then it produces output like:
 
-   00057e20 203 00 00 00 fc 6f 05 08 fc df 00 00 04 00 00 00            .....o..........
+   00057e20  03 00 00 00 fc 6f 05 08 fc df 00 00 04 00 00 00  |.....o..........|
 
  * else if the program is called with the -C flag it produces
 
@@ -37,8 +37,11 @@ static void usage(const char* name)
 }
 
 /*
- * This example s based on the feature that a std::string can be formatted
- * as a string or as a container of characters.
+ * The ascii format is based on the feature that a std::string can be
+ * formatted as a string or as a container of characters.  The hex formats
+ * print each block read from the file with a single '%D' (hex dump) format;
+ * a tsio::HexDump carries the offset and the repeated line detection from
+ * block to block.
  */
 
 static void dump(const char* fileName, unsigned format)
@@ -52,6 +55,27 @@ static void dump(const char* fileName, unsigned format)
         exit(1);
     }
 
+    if (format != asciiFormat) {
+        const char* dumpFormat = format == hexFormat ? "%.16D" : "%D";
+        HexDump hexDump;
+
+        for (;;) {
+            char buf[65536];
+            is.read(buf, sizeof(buf));
+
+            size_t count = is.gcount();
+
+            if (count == 0) {
+                break;
+            }
+
+            oprintf(dumpFormat, hexDump(buf, count));
+        }
+
+        oprintf(dumpFormat, hexDump.end());
+        return;
+    }
+
     size_t totalCount = 0;
 
     for (;;) {
@@ -67,24 +91,9 @@ static void dump(const char* fileName, unsigned format)
         std::string s(buf, count);
         size_t rStart = (count >= 8) ? 8 : count;
 
-        switch (format) {
-            case asciiFormat:
-                oprintf("%2{%08x  %[%#5C%]%#60T%S\n%}",
-                        totalCount, s.substr(0,8), s.substr(0,8),
-                        totalCount + 8, s.substr(rStart, 8), s.substr(rStart, 8));
-
-                break;
-
-            case hexFormat:
-                oprintf("%08x  %[%02x %]%#70T%S\n", totalCount, s, s);
-                break;
-
-            case classicFormat:
-                oprintf("%08x %2{ %[%02x %]%}%#61T|%S|\n", totalCount,
-                        s.substr(0,8), s.substr(rStart, 8), s);
-                break;
-
-        }
+        oprintf("%2{%08x  %[%#5C%]%#60T%S\n%}",
+                totalCount, s.substr(0,8), s.substr(0,8),
+                totalCount + 8, s.substr(rStart, 8), s.substr(rStart, 8));
 
         totalCount += count;
     }
@@ -108,6 +117,29 @@ static void overview(const char* fileName, unsigned format)
         exit(1);
     }
 
+    if (format != asciiFormat) {
+        const char* dumpFormat = format == hexFormat
+                                 ? "%.16D"      // hex dump, 16 bytes in one group
+                                 : "%D";        // hex dump, 16 bytes per line in groups of 8
+        HexDump hexDump;                        // offset and last line of the dump so far
+
+        for (;;) {
+            char buf[65536];
+            is.read(buf, sizeof(buf));
+
+            size_t count = is.gcount();
+
+            if (count == 0) {
+                break;
+            }
+
+            oprintf(dumpFormat, hexDump(buf, count));
+        }
+
+        oprintf(dumpFormat, hexDump.end());     // the rest of the last line and the final offset
+        return;
+    }
+
     size_t totalCount = 0;
 
     for (;;) {
@@ -122,49 +154,17 @@ static void overview(const char* fileName, unsigned format)
 
         std::string s(buf, count);
 
-        switch (format) {
-            case asciiFormat:
-                oprintf("%2{"           // repeat twice
-                          "%08x  "      // print totalCount
-                          "%["          // begin loop format
-                            "%#5C"      // print one character or escape sequence
-                          "%]"          // end loop format
-                          "%#60T"       // skip to column 60
-                          "%S"          // print string; replace unprintable width '.'
-                          "\n"          // new linme
-                        "%}",           // end repeat
-                        totalCount, s.substr(0,8), s.substr(0,8),
-                        totalCount + 8, s.substr(8, 8), s.substr(8, 8));
-
-                break;
-
-            case hexFormat:
-                oprintf("%08x  "        // print totalCount
-                        "%["            // begin loop format
-                          "%02x "       // print a character in hex
-                        "%]"            // end loop format
-                        "%#70T"         // skip to column 70
-                        "%S"            // print string; replace unprintable width '.'
-                        "\n",           // new linme
-                        totalCount, s, s);
-                break;
-
-            case classicFormat:
-                oprintf("%08x "
-                        "%2{ "          // repeat twice
-                          "%["          // begin loop forma
-                            "%02x "     // print a character in hex
-                          "%]"          // end loop format
-                        "%}"            // end repeat
-                        "%#61T"         // skip to column 61
-                        "|"             // verical bar
-                        "%S"            // print string; replace unprintable width '.'
-                        "|\n",          // verical bar and new line
-                        totalCount,
-                        s.substr(0,8), s.substr(8, 8), s);
-                break;
-
-        }
+        oprintf("%2{"           // repeat twice
+                  "%08x  "      // print totalCount
+                  "%["          // begin loop format
+                    "%#5C"      // print one character or escape sequence
+                  "%]"          // end loop format
+                  "%#60T"       // skip to column 60
+                  "%S"          // print string; replace unprintable width '.'
+                  "\n"          // new linme
+                "%}",           // end repeat
+                totalCount, s.substr(0,8), s.substr(0,8),
+                totalCount + 8, s.substr(8, 8), s.substr(8, 8));
 
         totalCount += count;
     }
@@ -1,5 +1,7 @@
 #include "tsio.h"
 
+#include <cmath>
+
 /**********************************************************************************
  * This example program generates a printed report for quarterly customer data.
  *
@@ -358,6 +360,50 @@ static void overview(const ReportData& report, unsigned year, unsigned quarter)
             year, quarter, report);     // arguments
 }
 
+/*
+ * The function withFixedPoint prints the same report with the quarterly
+ * totals stored as a number of cents in a tsio::Fixed<2>.
+ *
+ * Fixed point values use the same '%10.2f' format as the doubles, but are
+ * formatted without floating point arithmetic.
+ */
+
+static void withFixedPoint(const ReportData& report, unsigned year, unsigned quarter)
+{
+    using FixedCustomerData = std::tuple<unsigned, std::string, tsio::Fixed<2>, MonthlyData>;
+    std::vector<FixedCustomerData> fixedReport;
+
+    for (const auto& customer : report) {
+        fixedReport.emplace_back(std::get<0>(customer),
+                                 std::get<1>(customer),
+                                 tsio::Fixed<2>(std::llround(std::get<2>(customer) * 100)),
+                                 std::get<3>(customer));
+    }
+
+    oprintf("Yearly report for %dQ%d\n"
+            "%72{-%}\n%[%3N %<%5d %-20s%10.2f     %[%6.2f%%%]\n%>%]%72{-%}\n",
+            year, quarter, fixedReport);
+}
+
+/*
+ * The function withUtf8Names prints a report for customers with names that
+ * are not plain ASCII.  '%-20s' pads to 20 bytes, which misaligns the
+ * columns after such names.  The '~' flag pads to 20 display columns instead.
+ */
+
+static void withUtf8Names(unsigned year, unsigned quarter)
+{
+    ReportData report = setUp();
+
+    std::get<1>(report[0]) = "Jørgensen";
+    std::get<1>(report[1]) = "Müller-Lüdenscheidt";
+    std::get<1>(report[2]) = "東京商事";
+
+    oprintf("Yearly report for %dQ%d\n"
+            "%72{-%}\n%[%3N %<%5d %~-20s%10.2f     %[%6.2f%%%]\n%>%]%72{-%}\n",
+            year, quarter, report);
+}
+
 /*
  * The function withFmt shows the generation of the same report using
  * std::ostream formating, but with the fmt manipulator to set the ostream flags
@@ -424,6 +470,12 @@ int main()
     oprintf("\n\n\noverview:\n\n");
     overview(report, 2018, 1);
 
+    oprintf("\n\n\nfixed point:\n\n");
+    withFixedPoint(report, 2018, 1);
+
+    oprintf("\n\n\nUTF-8 names:\n\n");
+    withUtf8Names(2018, 1);
+
     oprintf("\n\n\nfmt io manipulator:\n\n");
     withFmt(report, 2018, 1);
 
@@ -1,5 +1,6 @@
 #include "tsio.h"
 
+#include <chrono>
 #include <iostream>
 #include <ctime>
 
@@ -97,5 +98,17 @@ int main()
     oprintf("%(%#d, %#m %d %y%)\n",*lTime);
     oprintf("%(%#3.3d, %#3.3m %d %y%)\n",*lTime);
     oprintf("\n");
+
+    /*
+     * std::chrono::system_clock::time_point values have a built-in formatter
+     * that supports the same fields, and %f for fractions of a second.
+     * The date and time part is only formatted again when the second changes.
+     */
+
+    auto now = std::chrono::system_clock::now();
+
+    oprintf("%(%y/%02m/%02d %02H:%02M:%02S.%f%)\n", now);
+    oprintf("%(%#3.3d, %#3.3m %d %y %02H:%02M:%02S.%.3f%)\n", now);
+    oprintf("%s\n", now);
 }
 
@@ -0,0 +1,368 @@
+#include "tsioSink.h"
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace tsio;
+
+static std::atomic<unsigned> failures(0);
+
+template <typename E, typename F>
+void expect(const E& expected, const F& found, const char* what)
+{
+    if (expected != found) {
+        std::cerr << what << ": expected '" << expected << "'; found '" << found << "'." << std::endl;
+        failures++;
+    }
+}
+
+static std::string readFile(const std::string& name)
+{
+    std::ifstream is(name);
+    std::stringstream ss;
+
+    ss << is.rdbuf();
+    return ss.str();
+}
+
+static bool exists(const std::string& name)
+{
+    return access(name.c_str(), F_OK) == 0;
+}
+
+static void testRotatingFileSink()
+{
+    char dirName[] = "/tmp/tsioSinkXXXXXX";
+
+    if (mkdtemp(dirName) == nullptr) {
+        expect(true, false, "mkdtemp");
+        return;
+    }
+
+    std::string base = fstring("%s/test.log", dirName);
+    std::string expected;
+
+    {
+        RotatingFileSink sink(base, 100);
+
+        sink.setKeepCount(3);
+
+        for (int i = 0; i < 40; ++i) {
+            fprintf(sink, "%05d %s\n", i, "rotating file sink");
+            asprintf(expected, "%05d %s\n", i, "rotating file sink");
+        }
+
+        CFormat cf("%05d %s\n");
+
+        fprintf(sink, cf, 40, "via CFormat");
+        asprintf(expected, cf, 40, "via CFormat");
+    }
+
+    // 40 lines of 25 bytes and one of 18 bytes: 11 segments, the oldest 8
+    // removed; the last segment counts toward the keep count too.
+    std::string found;
+
+    for (unsigned i = 1; i <= 11; ++i) {
+        std::string name = fstring("%s.%06u", base, i);
+
+        if (i <= 8) {
+            expect(false, exists(name), "removed segment exists");
+        } else {
+            std::string text = readFile(name);
+
+            expect(true, text.size() <= 100, "segment size");
+            found += text;
+        }
+    }
+
+    expect(false, exists(fstring("%s.%06u", base, 12)), "extra segment exists");
+    expect(100u * 2 + 18, found.size(), "kept size");
+    expect(expected.substr(expected.size() - found.size()), found, "kept text");
+
+    // a new sink continues the numbering
+    {
+        RotatingFileSink sink(base, 100);
+
+        fprintf(sink, "%s\n", "restarted");
+        expect(fstring("%s.%06u", base, 12), sink.currentName(), "current name");
+    }
+
+    expect("restarted\n", readFile(fstring("%s.%06u", base, 12)), "restarted segment");
+
+    for (unsigned i = 9; i <= 12; ++i) {
+        unlink(fstring("%s.%06u", base, i).c_str());
+    }
+
+    rmdir(dirName);
+}
+
+// Retired segments are compressed without a shell, so a quote in the name
+// does no harm, and the last segment is compressed as well.
+static void testCompression()
+{
+    char dirName[] = "/tmp/tsio'SinkXXXXXX";
+
+    if (mkdtemp(dirName) == nullptr) {
+        expect(true, false, "mkdtemp");
+        return;
+    }
+
+    std::string base = fstring("%s/it's.log", dirName);
+
+    {
+        RotatingFileSink sink(base, 100);
+
+        sink.setKeepCount(2);
+        sink.setCompressCommand("gzip -f");
+
+        for (int i = 0; i < 10; ++i) {
+            fprintf(sink, "%05d %s\n", i, "compressed segment");
+        }
+    }
+
+    // 10 lines of 25 bytes: 3 segments, the oldest removed
+    expect(false, exists(fstring("%s.%06u.gz", base, 1)), "removed segment exists");
+    expect(true, exists(fstring("%s.%06u.gz", base, 2)), "segment 2 compressed");
+    expect(true, exists(fstring("%s.%06u.gz", base, 3)), "last segment compressed");
+    expect(false, exists(fstring("%s.%06u", base, 3)), "last segment left uncompressed");
+
+    for (unsigned i = 2; i <= 3; ++i) {
+        unlink(fstring("%s.%06u.gz", base, i).c_str());
+    }
+
+    rmdir(dirName);
+}
+
+// Records are not lost while a segment cannot be opened: the current segment
+// stays in use (or, without one, records are dropped) until a retry succeeds.
+static void testOpenFailure()
+{
+    char dirName[] = "/tmp/tsioSinkXXXXXX";
+
+    if (mkdtemp(dirName) == nullptr) {
+        expect(true, false, "mkdtemp");
+        return;
+    }
+
+    std::string base = fstring("%s/log", dirName);
+    std::string second = fstring("%s.%06u", base, 2);
+    std::string third = fstring("%s.%06u", base, 3);
+
+    {
+        RotatingFileSink sink(base, 10);
+
+        for (int i = 0; i < 100 && !exists(second); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // the prepared segment 2 stays usable, segment 3 cannot be created
+        unlink(fstring("%s.%06u", base, 1).c_str());
+        unlink(second.c_str());
+        rmdir(dirName);
+
+        fprintf(sink, "first\n");
+        fprintf(sink, "second\n");
+        fprintf(sink, "third\n");
+        expect(second, sink.currentName(), "segment after a failed open");
+
+        mkdir(dirName, 0700);
+
+        for (int i = 0; i < 50 && sink.currentName() != third; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            fprintf(sink, "retry\n");
+        }
+
+        expect(third, sink.currentName(), "segment after a retry");
+    }
+
+    expect("retry\n", readFile(third), "first record after a retry");
+    unlink(third.c_str());
+
+    // the first segment cannot be opened
+    std::string subName = fstring("%s/sub", dirName);
+    std::string first = subName + "/log.000001";
+
+    {
+        RotatingFileSink sink(subName + "/log", 0);
+
+        fprintf(sink, "lost\n");
+        mkdir(subName.c_str(), 0700);
+
+        for (int i = 0; i < 50 && readFile(first).empty(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            fprintf(sink, "found\n");
+        }
+    }
+
+    expect("found\n", readFile(first), "first segment after a retry");
+    unlink(first.c_str());
+    rmdir(subName.c_str());
+    rmdir(dirName);
+}
+
+static void testConsoleSink()
+{
+    char fileName[] = "/tmp/tsioConsoleXXXXXX";
+    int fd = mkstemp(fileName);
+
+    if (fd < 0) {
+        expect(true, false, "mkstemp");
+        return;
+    }
+
+    int savedOut = dup(STDOUT_FILENO);
+
+    dup2(fd, STDOUT_FILENO);
+    useConsoleSinks();
+
+    const unsigned threadCount = 16;
+    const unsigned lineCount = 1000;
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([t] {
+            CFormat cf("%3u %5u %60{*%}\n");
+
+            for (unsigned i = 0; i < lineCount; ++i) {
+                if (i % 2) {
+                    oprintf("%3u %5u %60{*%}\n", t, i);
+                } else {
+                    oprintf(cf, t, i);
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    useConsoleSinks(false);
+    dup2(savedOut, STDOUT_FILENO);
+    close(savedOut);
+    close(fd);
+
+    std::ifstream is(fileName);
+    std::string line;
+    std::vector<unsigned> next(threadCount, 0);
+    std::string stars(60, '*');
+    unsigned lines = 0;
+
+    while (std::getline(is, line)) {
+        unsigned t = std::stoul(line.substr(0, 3));
+        unsigned i = std::stoul(line.substr(4, 5));
+
+        expect(70u, line.size(), "line size");
+        expect(true, t < threadCount, "thread number");
+
+        if (t < threadCount) {
+            expect(next[t], i, "line number");
+            next[t] = i + 1;
+        }
+
+        expect(stars, line.substr(10), "line text");
+        lines++;
+    }
+
+    expect(threadCount * lineCount, lines, "line count");
+    unlink(fileName);
+}
+
+static void testThreadBuffering()
+{
+    std::ostringstream os1;
+    std::ostringstream os2;
+
+    setThreadBuffering(100);
+
+    for (int i = 0; i < 10; ++i) {
+        fprintf(os1, "%9d\n", i);
+    }
+
+    expect("", os1.str(), "buffered");
+
+    fprintf(os1, "%9d\n", 10);
+    expect(100u, os1.str().size(), "full buffer");
+
+    fprintf(os2, "%s", "other stream");
+    expect(110u, os1.str().size(), "switched stream");
+    expect("", os2.str(), "other stream buffered");
+
+    flush();
+    expect("other stream", os2.str(), "flush");
+
+    setThreadBuffering(100, true);
+    fprintf(os2, "%s", " without newline");
+    expect("other stream", os2.str(), "line buffered");
+    fprintf(os2, "%s\n", " with newline");
+    expect("other stream without newline with newline\n", os2.str(), "newline");
+
+    // records that do not fit in the buffer are written at once
+    setThreadBuffering(100);
+    fprintf(os2, "%s", std::string(150, '-'));
+    expect(std::string(150, '-'), os2.str().substr(os2.str().size() - 150), "large record");
+
+    fprintf(os1, "%s", "released");
+    flush(os2);
+    expect(110u, os1.str().size(), "flush of another stream");
+    flush(os1);
+    expect(118u, os1.str().size(), "flush of the stream");
+
+    // a sink gets the output buffered for it before it is destroyed
+    char dirName[] = "/tmp/tsioBufferXXXXXX";
+
+    if (mkdtemp(dirName) == nullptr) {
+        expect(true, false, "mkdtemp");
+    } else {
+        std::string base = fstring("%s/buffered.log", dirName);
+
+        {
+            RotatingFileSink sink(base, 0);
+
+            fprintf(sink, "%s\n", "buffered for a sink");
+        }
+
+        std::string name = fstring("%s.%06u", base, 1);
+
+        expect("buffered for a sink\n", readFile(name), "sink destroyed");
+        unlink(name.c_str());
+        rmdir(dirName);
+    }
+
+    setThreadBuffering(0);
+    fprintf(os2, "%s", "unbuffered");
+    expect("other stream without newline with newline\n" + std::string(150, '-') + "unbuffered", os2.str(),
+           "unbuffered");
+
+    std::ostringstream os3;
+
+    std::thread thread([&os3] {
+        setThreadBuffering();
+
+        for (int i = 0; i < 1000; ++i) {
+            fprintf(os3, "%d\n", i);
+        }
+
+        expect("", os3.str(), "thread buffered");
+    });
+
+    thread.join();
+    expect(3890u, os3.str().size(), "flushed at thread exit");
+}
+
+int main()
+{
+    testRotatingFileSink();
+    testCompression();
+    testOpenFailure();
+    testConsoleSink();
+    testThreadBuffering();
+
+    return failures == 0 ? 0 : 1;
+}
@@ -27,6 +27,11 @@
  */
 
 #include "tsio.h"
+
+#include <bitset>
+#include <cfloat>
+#include <cmath>
+#include <list>
 #include <map>
 #include <set>
 
@@ -159,15 +164,21 @@ static void testIntegral()
             }
 
             test(0x8000000000000000ull, "diouxX", spec1, spec2, nullptr, nullptr, "ll");
+            test(0xfedcba9876543210ull, "diouxX", spec1, spec2, nullptr, nullptr, "ll");
+            test(0x00000abcdef01234ull, "diouxX", spec1, spec2, nullptr, nullptr, "ll");
         }
     }
 
+    test(99, "diouxX", 9, 19);
+    test(-9, "diouxX", 19, 9);
+
 }
 
 static void testFloatingPoint()
 {
     long double longValues[] = {56e35, 12.34, 987.0, 56e35, 0., 456.78, -456.78};
-    double floatValues[] = {56e35, 12.34, 987.0, 56e35, 0., 456.78, -456.78};
+    double floatValues[] = {56e35, 12.34, 987.0, 56e35, 0., 456.78, -456.78, 0.125, 2.5, -0.5, 9.9999995,
+                            1e-320, 5e-324, 0.1, 1e22, 123456789012345680.0};
     int spec1s[] = {15, 0, 3, -1};
     int spec2s[] = {3, 0, -1, -2};
 
@@ -375,6 +386,242 @@ static void testBinaryFormat() {
     std::string text = fstring("%b %#b %B %#B", 2, 1234, 99, 9876);
 
     expect("10 0b10011010010 1100011 0B10011010010100", text);
+    text = fstring("%b|%#.70b|%#B", 0x8000000000000001ull, 0x1ffull, 0ull);
+    expect("1000000000000000000000000000000000000000000000000000000000000001|"
+           "0b0000000000000000000000000000000000000000000000000000000000000111111111|0", text);
+}
+
+static void testInt128()
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 big = ~static_cast<unsigned __int128>(0);
+    __int128 smallest = static_cast<__int128>(static_cast<unsigned __int128>(1) << 127);
+    std::string text;
+
+    text = fstring("%d|%u|%s", big, big, big);
+    expect("-1|340282366920938463463374607431768211455|340282366920938463463374607431768211455", text);
+
+    text = fstring("%d|%s", smallest, smallest);
+    expect("-170141183460469231731687303715884105728|-170141183460469231731687303715884105728", text);
+
+    text = fstring("%#x|%X", big >> 4, static_cast<unsigned __int128>(0x123456789abcdefull) << 64);
+    expect("0xfffffffffffffffffffffffffffffff|123456789ABCDEF0000000000000000", text);
+
+    text = fstring("%o|%#b", big, static_cast<unsigned __int128>(5) << 64);
+    expect("3777777777777777777777777777777777777777777|"
+           "0b1010000000000000000000000000000000000000000000000000000000000000000", text);
+
+    text = fstring("%+045d|%-42.40u|", static_cast<__int128>(big >> 28), static_cast<unsigned __int128>(10000000000000000000ull) * 1000);
+    expect("+00000000000001267650600228229401496703205375|0000000000000000010000000000000000000000  |", text);
+
+    text = fstring("%5d|%.0d|%x", static_cast<__int128>(-42), static_cast<__int128>(0), static_cast<unsigned __int128>(255));
+    expect("  -42||ff", text);
+#endif
+}
+
+static void testDecimal()
+{
+    std::string text;
+    Decimal amount(-123456, 2);
+
+    text = fstring("%f|%.1f|%.0f|%#.0f|%s|%.4s", amount, amount, amount, amount, amount, amount);
+    expect("-1234.560000|-1234.6|-1235|-1235.|-1234.56|-1234.5600", text);
+
+    text = fstring("%+12.2f|%-12.2f|%012.2f|%^12.2f|%'*12.2f", Decimal(5, 3), amount, amount, amount, amount);
+    expect("       +0.01|-1234.56    |-00001234.56|  -1234.56  |-****1234.56", text);
+
+    text = fstring("%e|%.2E|%g|%.3g|%#.3g|%g", amount, Decimal(995, 0), amount, Decimal(5, 6), Decimal(5, 6), Decimal(0, 4));
+    expect("-1.234560e+03|9.95E+02|-1234.56|5e-06|5.00e-06|0", text);
+
+    text = fstring("%[%6.2f%]", std::vector<Fixed<2>>{Fixed<2>(100), Fixed<2>(-5), Fixed<2>()});
+    expect("  1.00 -0.05  0.00", text);
+
+    text = fstring("%.2f|%.2f|%.20f", Decimal(-5, 3), Decimal(9223372036854775807ll, 19), Decimal(1, 19));
+    expect("-0.01|0.92|0.00000000000000000010", text);
+}
+
+static void testGrouping()
+{
+    std::string text;
+
+    text = fstring("%,d|%,d|%,u|%,d|%,.7d", 1234567, -123, 1000u, 0, 1234);
+    expect("1,234,567|-123|1,000|0|0,001,234", text);
+
+    text = fstring("%,12d|%-,12d|%^,12d|%'*,12d|%,012d|%,08d", 1234567, 1234567, 1234567, 1234567, -1234567, 1234);
+    expect("   1,234,567|1,234,567   | 1,234,567  |***1,234,567|-001,234,567|0,001,234", text);
+
+    text = fstring("%=_x|%#=_X|%=.:2d|%= :3b|%,o", 0x12345678, 0xabcdef, 1234567, 0x2d, 01234567);
+    expect("1234_5678|0XAB_CDEF|1.23.45.67|101 101|1,234,567", text);
+
+    text = fstring("%,.2f|%,s|%,.2e|%+,014.1f|%,g", Decimal(123456789, 2), Decimal(-100000, 0),
+                   Decimal(123456789, 2), Decimal(123456789, 2), Decimal(1234567, 0));
+    expect("1,234,567.89|-100,000|1.23e+06|+001,234,567.9|1.23457e+06", text);
+}
+
+static void testFloatRounding()
+{
+    std::string text;
+
+    // values and precisions that need more than 128 bit arithmetic
+    double values[] = {1e300, -1.7976931348623157e308, 5e-324, 2.2250738585072014e-308, 1e-5, 0.1, 1e23};
+    const char* formats[] = {"%.0f", "%.3f", "%.40f", "%.1074f", "%.0e", "%.16e", "%.60e", "%.700e",
+                             "%g", "%.17g", "%#.40g", "%.800G", "%+.30e", "%-#.0e"};
+    char buf[2000];
+
+    for (auto value : values) {
+        for (auto format : formats) {
+            snprintf(buf, sizeof(buf), format, value);
+            expect(buf, fstring(format, value), value);
+        }
+    }
+
+    // widths and precisions beyond any fixed size buffer
+    static char large[8000];
+
+    snprintf(large, sizeof(large), "%-4000.2000f|%3000.1500Le|%.3000g", 1e300, 1e-300L, 0.1);
+    expect(large, fstring("%-4000.2000f|%3000.1500Le|%.3000g", 1e300, 1e-300L, 0.1));
+
+    expect("0.1000000000000000055511151231257827021181583404541015625", fstring("%.55f", 0.1));
+    expect("0|2|2|-0|2e+00|2.2e+00|0.12", fstring("%.0f|%.0f|%.0f|%.0f|%.0e|%.1e|%.2f", 0.5, 1.5, 2.5, -0.5, 1.5, 2.25, 0.125));
+    expect("  1.0e+01  |+1,234.50", fstring("%^11.1e|%+,.2f", 9.96, 1234.5));
+
+    text = fstring("%.0a|%.1a|%.0a|%.0La|%#.0A|%La|%011a", 1.5, 1.03125, std::ldexp(1.0, -1023), 15.5L, 0.0, 1.0L, -2.5);
+    expect("0x2p+0|0x1.0p+0|0x0p-1022|0x1p+4|0X0.P+0|0x8p-3|-0x001.4p+1", text);
+}
+
+static void testShortest()
+{
+    std::string text;
+
+    text = fstring("%s|%s|%s|%s|%s|%s", 0.1, 0.3, -1.5, 100.0, 1e16, 1e17);
+    expect("0.1|0.3|-1.5|100|10000000000000000|1e+17", text);
+
+    text = fstring("%s|%s|%s|%s", 0.1 + 0.2, 1.0 / 3, 5e-324, 1.7976931348623157e308);
+    expect("0.30000000000000004|0.3333333333333333|5e-324|1.7976931348623157e+308", text);
+
+    text = fstring("%s|%s|%s|%s", -0.0, 1e-4, 1.234e-5, std::numeric_limits<double>::infinity());
+    expect("-0|0.0001|1.234e-05|inf", text);
+
+    text = fstring("%!g|%!G|%!e|%!E|%!f|%#!g", 1e-7, 1e-7, 123.25, 0.5, 1.5e-5, 2.0);
+    expect("1e-07|1E-07|1.2325e+02|5E-01|0.000015|2.", text);
+
+    text = fstring("%+10s|%-10s|%010s|%^10s|%,s|%.3s", 0.25, 0.25, -0.25, 0.25, 1234567.5, 0.1234);
+    expect("     +0.25|0.25      |-000000.25|   0.25   |1,234,567.5|0.123", text);
+
+    text = fstring("%010s|%-5s|%!G", -std::numeric_limits<double>::infinity(), std::nan(""), std::nan(""));
+    expect("      -inf|nan  |NAN", text);
+
+    text = fstring("%s|%s|%s|%s|%s|%s", 1.2f, 0.1f, 3.4028235e38f, 1e-45f, 16777216.0f, 1e9f);
+    expect("1.2|0.1|3.4028235e+38|1e-45|16777216|1e+09", text);
+
+    text = fstring("%.2f|%e|%g|%.10f|%!e|%8.3s", 1.2f, 1.2f, 1.2f, 1.2f, 1.2f, -2.5e-3f);
+    expect("1.20|1.200000e+00|1.2|1.2000000477|1.2e+00| -0.0025", text);
+
+    // every double and float round-trips
+    unsigned long long bits = 0x0123456789abcdefull;
+
+    for (int i = 0; i < 1000; ++i) {
+        double value;
+
+        bits = bits * 6364136223846793005ull + 1442695040888963407ull;
+        memcpy(&value, &bits, sizeof(value));
+
+        if (std::isfinite(value)) {
+            expect(value, strtod(fstring("%s", value).c_str(), nullptr));
+        }
+
+        float single;
+        unsigned singleBits = unsigned(bits >> 32);
+
+        memcpy(&single, &singleBits, sizeof(single));
+
+        if (std::isfinite(single)) {
+            expect(single, strtof(fstring("%s", single).c_str(), nullptr));
+        }
+    }
+}
+
+static void testWideFloat()
+{
+    std::string text;
+
+    // long double against the C library
+    long double values[] = {1e4000L, -1.5e-4000L, 0.1L, 1.0L / 3, 123456789.125L, 0.5L,
+                            std::numeric_limits<long double>::max(), std::numeric_limits<long double>::denorm_min()};
+    const char* formats[] = {"%.0Lf", "%.3Lf",  "%.30Lf",  "%.0Le",   "%.20Le", "%.60Le",
+                             "%Lg",   "%.21Lg", "%#.40Lg", "%+.30LE", "%-#.0Le"};
+    static char buf[6000];
+
+    for (auto value : values) {
+        for (auto format : formats) {
+            snprintf(buf, sizeof(buf), format, value);
+            expect(buf, fstring(format, value), value);
+        }
+    }
+
+#if LDBL_MANT_DIG == 64
+    text = fstring("%s|%s|%s|%s|%s", 0.1L, 1.0L / 3, -1e4000L, 1e20L, std::numeric_limits<long double>::denorm_min());
+    expect("0.1|0.33333333333333333334|-1e+4000|100000000000000000000|4e-4951", text);
+
+    text = fstring("%s|%!e|%Lf", std::numeric_limits<long double>::max(), 2.5L, 2.5L);
+    expect("1.189731495357231765e+4932|2.5e+00|2.500000", text);
+
+    // every long double round-trips
+    unsigned long long bits = 0x0123456789abcdefull;
+
+    for (int i = 0; i < 1000; ++i) {
+        bits = bits * 6364136223846793005ull + 1442695040888963407ull;
+
+        long double value = std::ldexp(static_cast<long double>(bits | 1ull << 63), int(bits % 32000) - 16000);
+
+        expect(value, strtold(fstring("%s", value).c_str(), nullptr));
+    }
+#endif
+
+#ifdef __SIZEOF_FLOAT128__
+    __float128 one = 1;
+
+    text = fstring("%s|%s|%s|%.5f|%e|%g", one / 10, one / 3, one * 1e300 * 1e300, -one * 5 / 2, one / 3, one * 1e20);
+    expect("0.1|0.3333333333333333333333333333333333|1.0000000000000001050095205104088433e+600|-2.50000|"
+           "3.333333e-01|1e+20",
+           text);
+
+    text = fstring("%.40e|%-12.3f|%!G|%010s", one / 3, one * 2 / 3, one / 1000000,
+                   -one * std::numeric_limits<double>::infinity());
+    expect("3.3333333333333333333333333333333331728392e-01|0.667       |1E-06|      -inf", text);
+#endif
+}
+
+static void testBits()
+{
+    std::string text;
+    std::bitset<12> b(0xabc);
+    std::bitset<130> big;
+
+    big[129] = true;
+    big[64] = true;
+    big[0] = true;
+
+    text = fstring("%b|%#x|%-6X|%d|%s", b, b, b, b, std::bitset<3>(5));
+    expect("101010111100|0xabc|ABC   |2748|101", text);
+
+    text = fstring("%x", big);
+    expect("200000000000000010000000000000001", text);
+
+    text = fstring("%= :8b|%=_x", std::bitset<20>(0xf00ff), big);
+    expect("1111 00000000 11111111|2_0000_0000_0000_0001_0000_0000_0000_0001", text);
+
+    text = fstring("%[%d%]|%2.3[%d,%#]", std::bitset<4>(6), b);
+    expect("0110|0,1,1", text);
+
+    // as with integers, '#' adds no prefix to zero
+    text = fstring("%#x|%#b|%#x|%#x", std::bitset<8>(), std::bitset<3>(), std::bitset<8>(1), 0);
+    expect("00|000|0x01|0", text);
+
+    std::vector<bool> v = {true, true, false, true, false, false, false, false, true};
+
+    text = fstring("%b|%x|%=.:4b|%d", v, v, v, std::vector<bool>{true, false});
+    expect("110100001|d08|1101.0000.1|10", text);
 }
 
 static void testExtensions()
@@ -431,6 +678,65 @@ static void testExtensions()
     text = fstring("%#S", "12\a\b\f34");
     expect("12\\a\\b\\f34", text);
 
+    std::string body("GET /index.html?q=\"tsio\" HTTP/1.1\r\nHost: example.org\r\n\r\n\x01\xff\x7f'\\");
+
+    text = fstring("%S|%#S|%#.20S|%#-70S|", body, body, body, body.substr(0, 20));
+    expect("GET /index.html?q=\"tsio\" HTTP/1.1..Host: example.org.......'\\|"
+           "GET /index.html?q=\\\"tsio\\\" HTTP/1.1\\r\\nHost: example.org\\r\\n\\r\\n\\001\\377\\177\\'\\\\|"
+           "GET /index.html?q=\\\"|"
+           "GET /index.html?q=\\\"t                                                 |",
+           text);
+
+    // JSON, HTML, URL and CSV escaping
+    text = fstring("%&jS|%#&jS|%&hS|%&uS", body, "a\"b", "<a href='x'>&</a>", "a b/ü~._-");
+    expect("GET /index.html?q=\\\"tsio\\\" HTTP/1.1\\r\\nHost: example.org\\r\\n\\r\\n\\u0001\xff\\u007f'\\\\|"
+           "\"a\\\"b\"|&lt;a href=&#39;x&#39;&gt;&amp;&lt;/a&gt;|a%20b%2F%C3%BC~._-",
+           text);
+
+    text = fstring("%&cS|%&cS|%#&cS|%&cS", "plain", "a,b", "x", "say \"hi\"\n");
+    expect("plain|\"a,b\"|\"x\"|\"say \"\"hi\"\"\n\"", text);
+
+    text = fstring("%-&h12S|%&u12S|%&j.3S|%^#&j9S|%&hS", "<b>", "a b", "\t\tx", "ab", std::string(40, 'a') + "&" + std::string(20, 'b'));
+    expect("&lt;b&gt;   |       a%20b|\\t|  \"ab\"   |" + std::string(40, 'a') + "&amp;" + std::string(20, 'b'), text);
+
+    // a precision cuts between escapes and keeps the closing quote
+    text = fstring("%&j#.6S|%&c#.6S|%#.3S|%&j#.1S|%&c8.5S|", "ab\"cdef", "x,y\"z", "\x01xyz", "abc", "a\"b");
+    expect("\"ab\\\"\"|\"x,y\"||\"\"|   \"a\"\"\"|", text);
+
+    // hex dumps of strings and byte containers
+    std::string bytes(":;<=>?@ABCDEFGHIJKLM\0\x7f\xff hello\tworld", 35);
+    std::vector<unsigned char> packet(bytes.begin(), bytes.begin() + 10);
+
+    text = fstring("%D", bytes);
+    expect("00000000  3a 3b 3c 3d 3e 3f 40 41  42 43 44 45 46 47 48 49  |:;<=>?@ABCDEFGHI|\n"
+           "00000010  4a 4b 4c 4d 00 7f ff 20  68 65 6c 6c 6f 09 77 6f  |JKLM... hello.wo|\n"
+           "00000020  72 6c 64                                          |rld|\n"
+           "00000023\n",
+           text);
+
+    text = fstring("%6.4D|%D%D", packet, "", std::array<char, 4>{{'w', 'x', 'y', 'z'}});
+    expect("00000000  3a 3b 3c 3d  3e 3f  |:;<=>?|\n"
+           "00000006  40 41 42 43         |@ABC|\n"
+           "0000000a\n|"
+           "00000000  77 78 79 7a                                       |wxyz|\n"
+           "00000004\n",
+           text);
+
+    // a dump in pieces continues the offsets and collapses repeated lines
+    std::string block(40, 'A');
+    HexDump dump;
+
+    block += "tail";
+    text = fstring("%D", dump(block.data(), 5));
+    text += fstring("%D", dump(block.data() + 5, 30));
+    text += fstring("%D", dump(block.data() + 35, 9));
+    text += fstring("%D", dump.end());
+    expect("00000000  41 41 41 41 41 41 41 41  41 41 41 41 41 41 41 41  |AAAAAAAAAAAAAAAA|\n"
+           "*\n"
+           "00000020  41 41 41 41 41 41 41 41  74 61 69 6c              |AAAAAAAAtail|\n"
+           "0000002c\n",
+           text);
+
     text = fstring("%^20s", "1234");
     expect("        1234        ", text);
 
@@ -440,6 +746,50 @@ static void testExtensions()
     text = fstring("%^20s", "abc");
     expect("        abc         ", text);
 
+    // neither array is null terminated
+    const char raw[4] = {'a', 'b', 'c', 'd'};
+    std::array<char, 4> chars = {{'w', 'x', 'y', 'z'}};
+
+    text = fstring("%.3s|%#.2S|%s|%^8S|%.2s", static_cast<const char*>(raw), static_cast<const char*>(raw), chars,
+                   chars, chars);
+    expect("abc|ab|wxyz|  wxyz  |wx", text);
+
+    // 'ü' takes 2 bytes, '東' and '京' take 3 bytes and 2 columns each, the
+    // combining acute accent takes 2 bytes and no columns
+    std::string names[] = {"Müller", "東京商事", "Jose\xcc\x81", "\xff\xfe", std::string(40, 'a') + "ü"};
+
+    text = fstring("%~-8s|%~8s|%~^8s|%~-6s|%~.41s|", names[0], names[1], names[2], names[3], names[4]);
+    expect("Müller  |東京商事|  Jose\xcc\x81  |\xff\xfe    |" + names[4] + "|", text);
+
+    text = fstring("%~.3s|%~.5s|%~.4s|%~.40s|%.5s|%~5.1s|", names[0], names[1], names[2], names[4], names[1], names[1]);
+    expect("Mül|東京|Jose\xcc\x81|" + std::string(40, 'a') + "|東\xe4\xba|     |", text);
+
+    // UTF-16 and UTF-32 text is printed as UTF-8; width and precision count
+    // code points.  U+1F600 is a surrogate pair in UTF-16.
+    std::u16string u16 = u"Grüße \U0001F600!";
+    std::u32string u32 = U"東京 \U0001F600";
+    std::wstring wide = L"naïve";
+    const char16_t* u16Pointer = u"mañana";
+    char32_t u32Array[] = U"años";
+    std::u16string lone = u"a\xd800z\xdc00";
+    std::u16string longText(40, u'x');
+
+    text = fstring("%s|%-10s|%6s|%^9s|%.3s|%.7s", u16, u16, u32, wide, wide, u16);
+    expect("Grüße \U0001F600!|Grüße \U0001F600!  |  東京 \U0001F600|  naïve  |naï|Grüße \U0001F600", text);
+
+    text = fstring("%s|%8.4s|%s|%s|%.20s", u16Pointer, u16Pointer, u32Array, lone, longText + u"ü");
+    expect("mañana|    maña|años|a\xef\xbf\xbdz\xef\xbf\xbd|" + std::string(20, 'x'), text);
+
+    text = fstring("%s|%~6s|%#S|%x", longText + u"é" + longText, u32, u"tab\t", std::u16string(u"AB"));
+    expect(std::string(40, 'x') + "é" + std::string(40, 'x') + "|東京 \U0001F600|tab\\t|4142", text);
+
+#if __cplusplus >= 201703L
+    std::string_view view("view\tinto a buffer", 10);
+
+    text = fstring("%s|%-12s|%.4s|%#S|%S|%c", view, view, view, view, view.substr(4), view);
+    expect("view\tinto |view\tinto   |view|view\\tinto |.into |view\tinto ", text);
+#endif
+
     text = fstring("%+'*\"@20d", 123);
     expect("+****************123", text);
 
@@ -615,6 +965,56 @@ static void testRanges()
     text = fstring("set {%5d }", s);
     expect("set {    1    2    3  100 1000 }", text);
 
+    std::vector<long long> big(600);
+    std::string expected;
+
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = i % 2 ? -(1ll << (i % 63)) : (1ll << (i % 63));
+        expected += std::to_string(big[i]) + (i + 1 < big.size() ? ";" : "");
+    }
+
+    text = fstring("%[%d;%#]", big);
+    expect(expected, text);
+
+    std::array<short, 4> sa = {{5, -60, 700, -8000}};
+
+    text = fstring("%[<%-4d>%] %2.2[%+d %] %[%x,%]", sa, sa, sa);
+    expect("<5   ><-60 ><700 ><-8000> -60 +700  5,ffc4,2bc,e0c0,", text);
+
+    std::vector<double> dv(600);
+    std::vector<float> fv(dv.size());
+    std::string expectedFixed;
+    std::string expectedWidth;
+    std::string expectedFloats;
+    char buffer[400];
+
+    for (size_t i = 0; i < dv.size(); ++i) {
+        dv[i] = (i % 2 ? -1.0 : 1.0) * std::ldexp(double(i * 2654435761u % 100000), int(i % 90) - 60);
+        fv[i] = float(dv[i]);
+        snprintf(buffer, sizeof(buffer), "%.3f;", dv[i]);
+        expectedFixed += buffer;
+        snprintf(buffer, sizeof(buffer), "%10.0f", dv[i]);
+        expectedWidth += buffer;
+        snprintf(buffer, sizeof(buffer), "<%-9.2f>", double(fv[i]));
+        expectedFloats += buffer;
+    }
+
+    text = fstring("%[%.3f;%]", dv);
+    expect(expectedFixed, text);
+
+    text = fstring("%10.0f", dv);
+    expect(expectedWidth, text);
+
+    text = fstring("%[<%-9.2f>%]", fv);
+    expect(expectedFloats, text);
+
+    double special[] = {0.5, 1.5, 2.5, -0.0, 0.125, 1e20, -std::numeric_limits<double>::infinity()};
+
+    text = fstring("%[%.0f %]|%[%.2f %]|%[%+.1f %]", special, special, std::vector<float>(fv.begin() + 550, fv.end()));
+    expect("0 2 2 -0 0 100000000000000000000 -inf |0.50 1.50 2.50 -0.00 0.12 100000000000000000000.00 -inf |" +
+           fstring("%[%+.1f %]", std::list<float>(fv.begin() + 550, fv.end())),
+           text);
+
 }
 
 static void testCFormat()
@@ -631,6 +1031,54 @@ static void testCFormat()
 
 }
 
+static void testLimiter()
+{
+    std::string text;
+    Limiter sampler;
+    CFormat cf("%d,", sampler);
+
+    sampler.setSampling(3);
+
+    for (int i = 0; i < 7; ++i) {
+        asprintf(text, cf, i);
+    }
+
+    expect("0,[2 suppressed] 3,[2 suppressed] 6,", text);
+
+    Limiter limiter;
+    CFormat rf("%s", limiter);
+
+    limiter.setRateLimit(0.001, 2);
+
+    text = fstring(rf, "one");
+    expect("one", text);
+
+    text = fstring(rf, "two");
+    expect("two", text);
+
+    text = fstring(rf, "three");
+    expect("", text);
+
+    expect(0, sprintf(text, rf, "four"));
+    expect(2u, limiter.takeSuppressed());
+
+    Limiter slow;
+    CFormat sf("%s", slow);
+
+    slow.setRateLimit(1e-300, 3);
+
+    text = fstring(sf, "a");
+    text += fstring(sf, "b");
+    text += fstring(sf, "c");
+    text += fstring(sf, "d");
+    expect("abc", text);
+
+    slow.setRateLimit(0);
+
+    text = fstring(sf, "e");
+    expect("[1 suppressed] e", text);
+}
+
 static void testIndex()
 {
     std::string text;
@@ -677,6 +1125,59 @@ static void testS()
     expect(t1, t2);
 }
 
+static void testTime()
+{
+    std::string text;
+    char buf[128];
+    time_t t = 1700000000;
+    struct tm tm;
+
+    localtime_r(&t, &tm);
+
+    auto tp = std::chrono::system_clock::from_time_t(t) +
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(123456789));
+
+    snprintf(buf, sizeof(buf), "%04d/%02d/%02d %02d:%02d:%02d.%06d",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, 123456);
+    text = fstring("%(%y/%02m/%02d %02H:%02M:%02S.%f%)", tp);
+    expect(buf, text);
+
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d.%06d",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, 123456);
+    text = fstring("%s", tp);
+    expect(buf, text);
+
+    text = fstring("[%30s]", tp);
+    expect(std::string("[    ") + buf + "]", text);
+
+    text = fstring("[%.10s|%-12.10s]", tp, tp);
+    expect(std::string("[") + std::string(buf, 10) + "|" + std::string(buf, 10) + "  ]", text);
+
+    // same second, only the fraction changes
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d.%03d %%",
+            tm.tm_hour, tm.tm_min, tm.tm_sec, 124);
+    text = fstring("%(%02H:%02M:%02S.%.3f %%%)", tp + std::chrono::milliseconds(1));
+    expect(buf, text);
+
+    text = fstring("%(%02H:%02M:%02S.%.3f %%%)", tp + std::chrono::milliseconds(1));
+    expect(buf, text);
+
+    // next second
+    t++;
+    localtime_r(&t, &tm);
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d.%03d %%",
+            tm.tm_hour, tm.tm_min, tm.tm_sec, 123);
+    text = fstring("%(%02H:%02M:%02S.%.3f %%%)", tp + std::chrono::seconds(1));
+    expect(buf, text);
+
+    static const char* const days[7] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+    snprintf(buf, sizeof(buf), "%-5s|%02d", days[tm.tm_wday], tm.tm_year % 100);
+    text = fstring("%(%-#5.3d|%#02y%)", tp + std::chrono::seconds(1));
+    expect(buf, text);
+}
+
 class Custom
 {
     public:
@@ -745,15 +1246,24 @@ static void run()
     testString();
     testRepeatingFormats();
     testBinaryFormat();
+    testInt128();
+    testDecimal();
+    testGrouping();
+    testBits();
+    testFloatRounding();
+    testShortest();
+    testWideFloat();
     testPositional();
     testTuple();
     testCFormat();
+    testLimiter();
     testRanges();
     testIndex();
     testS();
     testExtensions();
     testNesting();
     testCustomized();
+    testTime();
 }
 
 static void test()
@@ -28,6 +28,36 @@
 
 #include "tsio.h"
 
+#include <cerrno>
+#include <cfloat>
+#include <chrono>
+#include <ctime>
+#include <unistd.h>
+
+#if defined(__SSE2__) || defined(__SSSE3__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+std::atomic<bool> tsioImplementation::consoleSinks(false);
+
+void tsioImplementation::writeAll(int fd, const char* data, size_t size)
+{
+    while (size != 0) {
+        ssize_t written = ::write(fd, data, size);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return;
+        }
+
+        data += written;
+        size -= written;
+    }
+}
+
 TSIO_NEVER_INLINE void tsioImplementation::Buffer::resize(size_t newSize)
 {
     size_t newLen = mLen;
@@ -49,71 +79,107 @@ TSIO_NEVER_INLINE void tsioImplementation::Buffer::resize(size_t newSize)
     mLen = newLen;
 }
 
-static void makeNice(tsioImplementation::Buffer& dest, const char* text, int size, bool alternative)
+// Display width of the code point 'c': 0 for combining marks and other zero
+// width characters, 2 for East Asian wide and fullwidth characters, else 1.
+static unsigned columnWidth(unsigned c)
 {
-    if (alternative) {
-        for (int i = 0; i < size; ++i) {
-            char c = text[i];
+    static const struct
+    {
+        unsigned first;
+        unsigned last;
+        unsigned width;
+    } ranges[] = {
+        {0x0300, 0x036f, 0}, {0x0483, 0x0489, 0}, {0x0591, 0x05bd, 0}, {0x0610, 0x061a, 0},
+        {0x064b, 0x065f, 0}, {0x0e31, 0x0e31, 0}, {0x0e34, 0x0e3a, 0}, {0x0e47, 0x0e4e, 0},
+        {0x1100, 0x115f, 2}, {0x1ab0, 0x1aff, 0}, {0x1dc0, 0x1dff, 0}, {0x200b, 0x200f, 0},
+        {0x20d0, 0x20ff, 0}, {0x2e80, 0x303e, 2}, {0x3041, 0x33ff, 2}, {0x3400, 0x4dbf, 2},
+        {0x4e00, 0x9fff, 2}, {0xa000, 0xa4cf, 2}, {0xac00, 0xd7a3, 2}, {0xf900, 0xfaff, 2},
+        {0xfe00, 0xfe0f, 0}, {0xfe10, 0xfe19, 2}, {0xfe20, 0xfe2f, 0}, {0xfe30, 0xfe6f, 2},
+        {0xff00, 0xff60, 2}, {0xffe0, 0xffe6, 2}, {0x1f300, 0x1f64f, 2}, {0x1f900, 0x1f9ff, 2},
+        {0x20000, 0x2fffd, 2}, {0x30000, 0x3fffd, 2}, {0xe0100, 0xe01ef, 0} };
+
+    if (c < ranges[0].first) {
+        return 1;
+    }
 
-            switch (c) {
-                case '\a':
-                    dest.append("\\a", 2);
-                    break;
+    size_t low = 0;
+    size_t high = sizeof(ranges) / sizeof(ranges[0]);
 
-                case '\b':
-                    dest.append("\\b", 2);
-                    break;
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
 
-                case '\f':
-                    dest.append("\\f", 2);
-                    break;
+        if (c < ranges[middle].first) {
+            high = middle;
+        } else {
+            low = middle;
+        }
+    }
 
-                case '\n':
-                    dest.append("\\n", 2);
-                    break;
+    return c <= ranges[low].last ? ranges[low].width : 1;
+}
 
-                case '\r':
-                    dest.append("\\r", 2);
-                    break;
+// Return the number of bytes of the longest prefix of the UTF-8 'text' that
+// fits in 'maxColumns' display columns, and its width in 'columns'.  Only
+// whole code points are taken.  A byte that does not start a valid sequence
+// counts as one column.  Runs of ASCII are checked 32 bytes at a time.
+static size_t measureColumns(const char* text, size_t size, size_t maxColumns, size_t& columns)
+{
+    const unsigned char* pt = reinterpret_cast<const unsigned char*>(text);
+    const unsigned char* end = pt + size;
+    size_t count = 0;
 
-                case '\t':
-                    dest.append("\\t", 2);
-                    break;
+    for (;;) {
+#if defined(__AVX2__)
+        while (end - pt >= 32 && maxColumns - count >= 32 &&
+               _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pt))) == 0) {
+            pt += 32;
+            count += 32;
+        }
+#elif defined(__SSE2__)
+        while (end - pt >= 32 && maxColumns - count >= 32 &&
+               _mm_movemask_epi8(_mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pt)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(pt + 16)))) == 0) {
+            pt += 32;
+            count += 32;
+        }
+#endif
 
-                case '\v':
-                    dest.append("\\v", 2);
-                    break;
+        if (pt == end) {
+            break;
+        }
 
-                case '\\':
-                    dest.append("\\\\", 2);
-                    break;
+        unsigned c = *pt;
+        unsigned length = 1;
 
-                case '\"':
-                    dest.append("\\\"", 2);
-                    break;
+        if (c >= 0xc2 && c < 0xf5) {
+            unsigned needed = c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+            unsigned code = c & (0x7f >> needed);
+            unsigned i = 1;
 
-                case '\'':
-                    dest.append("\\\'", 2);
-                    break;
+            for (; i < needed && pt + i < end && (pt[i] & 0xc0) == 0x80; ++i) {
+                code = (code << 6) | (pt[i] & 0x3f);
+            }
 
-                default:
-                    if (c < ' ' || c > '~') {
-                        dest.push_back('\\');
-                        dest.push_back(char(((c >> 6) & 0x3) + '0'));
-                        dest.push_back(char(((c >> 3) & 0x7) + '0'));
-                        dest.push_back(char((c & 0x7) + '0'));
-                    } else {
-                        dest.push_back(c);
-                    }
+            // reject overlong forms, surrogates and code points above 0x10ffff
+            if (i == needed && !(needed == 3 && (code < 0x800 || (code >= 0xd800 && code < 0xe000))) &&
+                !(needed == 4 && (code < 0x10000 || code > 0x10ffff))) {
+                c = code;
+                length = needed;
             }
         }
-    } else {
-        for (int i = 0; i < size; ++i) {
-            char c = text[i];
 
-            dest.push_back((c < ' ' || c > '~') ? '.' : c);
+        unsigned width = columnWidth(c);
+
+        if (maxColumns - count < width) {
+            break;
         }
+
+        count += width;
+        pt += length;
     }
+
+    columns = count;
+    return pt - reinterpret_cast<const unsigned char*>(text);
 }
 
 static void outputString(tsioImplementation::Format& format, const char* text, int size, int maxSize)
@@ -122,30 +188,36 @@ static void outputString(tsioImplementation::Format& format, const char* text, i
     auto& dest = format.dest;
     auto& state = format.nextNode->state;
     int minSize = state.width;
+    int length = size;
+
+    if (state.type & columns) {
+        size_t columnCount;
 
-    if (size > maxSize) {
+        size = int(measureColumns(text, size, maxSize, columnCount));
+        length = int(columnCount);
+    } else if (size > maxSize) {
         size = maxSize;
+        length = size;
     }
 
-    if (minSize <= size) {
+    if (minSize <= length) {
         dest.append(text, size);
     } else {
         unsigned type = state.type;
         char fillCharacter = (type & alfafill) ? state.fillCharacter : ' ';
         size_t destSize = dest.size();
+        size_t fillSize = minSize - length;
 
-        dest.widen(minSize);
+        dest.widen(size + fillSize);
 
         char* pt = dest.data() + destSize;
 
-        size_t fillSize = minSize - size;
-
         if (type & leftJustify) {
             pt = copy(pt, text, size);
             fill(pt, fillCharacter, fillSize);
         } else if (type & centerJustify) {
             size_t offset = fillSize / 2;
-            size_t rest = minSize - offset;
+            size_t rest = fillSize - offset;
 
             pt = fill(pt, fillCharacter, offset);
             pt = copy(pt, text, size);
@@ -157,943 +229,4260 @@ static void outputString(tsioImplementation::Format& format, const char* text, i
     }
 }
 
+// Only the first 'maxSize' bytes are looked at, so a precision also limits
+// the search for the terminating null.  A precision in columns does not.
 inline void outputString(tsioImplementation::Format& format, const char* text, int maxSize)
 {
-    outputString(format, text, strlen(text), maxSize);
+    bool inColumns = (format.nextNode->state.type & tsioImplementation::columns) != 0;
+
+    outputString(format, text, inColumns ? strlen(text) : strnlen(text, maxSize), maxSize);
 }
 
-template <int base, bool isSigned = false>
-static void outputNumber(tsioImplementation::Format& format, long long pNumber, unsigned type)
+// The escaping modes of '%S': dots for unprintable bytes, C escapes with
+// '#', and JSON, CSV, HTML and URL escaping with the '&' flag.
+enum EscapeMode { dotEscape, cEscape, jsonEscape, csvEscape, csvQuoteEscape, htmlEscape, urlEscape };
+
+// The bytes that an escaping mode does not copy as is: those in 'specials',
+// with 'controls' the control characters and DEL, and with 'high' all bytes
+// above 0x7f.  Bit 'h' of 'rows[l]' is set when ASCII byte 16 * h + l is in
+// the set, which allows a table lookup of 16 bytes at a time.
+struct EscapeSet
 {
-    using namespace tsioImplementation;
+    const char* specials;
+    bool controls;
+    bool high;
+    unsigned char rows[16];
+};
+
+static const EscapeSet escapeSets[] = {
+    {"", true, true, {0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x83}},
+    {"\\\"'", true, true, {0x03, 0x03, 0x07, 0x03, 0x03, 0x03, 0x03, 0x07, 0x03, 0x03, 0x03, 0x03, 0x23, 0x03, 0x03, 0x83}},
+    {"\\\"", true, false, {0x03, 0x03, 0x07, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x23, 0x03, 0x03, 0x83}},
+    {",\"\r\n", false, false, {0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x04, 0x01, 0x00, 0x00}},
+    {"\"", false, false, {0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {"&<>\"'", false, false, {0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x08, 0x00}},
+    {" !\"#$%&'()*+,/:;<=>?@[\\]^`{|}", true, true,
+     {0x57, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x0f, 0xaf, 0xaf, 0xab, 0x2b, 0x8f}}};
+
+// The most bytes written for one byte of text, by escaping mode.
+static const size_t escapeSizes[] = {1, 4, 6, 2, 2, 6, 3};
+
+static EscapeMode escapeMode(const tsioImplementation::FormatState& state)
+{
+    switch (state.escape) {
+        case 'j':
+            return jsonEscape;
 
-    auto& state = format.nextNode->state;
-    int size = state.width;
-    unsigned long long number = pNumber;
-    const size_t bufSize = 134; // allow for 128 binary digits plus radix indicator and sign
-    char buf[bufSize];
-    int precision = state.precisionGiven() ? state.precision : 1;
+        case 'c':
+            return csvEscape;
+
+        case 'h':
+            return htmlEscape;
 
-    if (precision < 0) {
-        precision = 0;
+        case 'u':
+            return urlEscape;
+
+        default:
+            return (state.type & tsioImplementation::alternative) ? cEscape : dotEscape;
     }
+}
 
-    char* actualPointer = buf + bufSize;
-    char* precisionPointer = actualPointer - precision;
-    char* prefixPointer;
-    char sign = 0;
+// Return a pointer to the first byte in [pt, end) that is in 'set'.
+static const char* findNasty(const char* pt, const char* end, const EscapeSet& set)
+{
+#ifdef __SSSE3__
+    // Bytes above 0x7f select neither a row nor a bit.
+    const __m128i rows = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.rows));
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibbles = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    const unsigned highs = set.high ? 0xffff : 0;
+
+    for (; end - pt >= 16; pt += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pt));
+        __m128i row = _mm_shuffle_epi8(rows, bytes);
+        __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbles));
+        unsigned clean = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), zero)));
+        unsigned mask = (clean ^ 0xffff) | (unsigned(_mm_movemask_epi8(bytes)) & highs);
+
+        if (mask != 0) {
+            return pt + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lastControl = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+
+    for (; end - pt >= 16; pt += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pt));
+        __m128i nasty = set.high ? _mm_cmplt_epi8(bytes, zero) : zero;
+
+        if (set.controls) {
+            nasty = _mm_or_si128(nasty,
+                                 _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(bytes, lastControl), bytes),
+                                              _mm_cmpeq_epi8(bytes, del)));
+        }
 
-    if (isSigned) {
-        if (pNumber < 0) {
-            sign = '-';
-            number = -pNumber;
-        } else if (type & plusIfPositive) {
-            sign = '+';
-        } else if (type & spaceIfPositive) {
-            sign = ' ';
+        for (const char* special = set.specials; *special != 0; ++special) {
+            nasty = _mm_or_si128(nasty, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(*special)));
+        }
+
+        unsigned mask = unsigned(_mm_movemask_epi8(nasty));
+
+        if (mask != 0) {
+            return pt + __builtin_ctz(mask);
         }
     }
+#elif __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // A borrow only flags bytes above one that is flagged correctly, so the
+    // lowest flag is exact.
+    const unsigned long long ones = 0x0101010101010101ull;
+    const unsigned long long highs = ones * 0x80;
 
-    if (precision != 0 || pNumber != 0) {
-        switch (base) {
-            case 2:
-                do {
-                    *(--actualPointer) = char((number & 1) + '0');
-                    number >>= 1;
-                } while (number != 0);
+    for (; end - pt >= 8; pt += 8) {
+        unsigned long long x;
 
-                while (actualPointer > precisionPointer) {
-                    *(--actualPointer) = '0';
-                }
+        memcpy(&x, pt, 8);
 
-                prefixPointer = actualPointer;
+        unsigned long long nasty = set.high ? x : 0;
 
-                if (type & alternative && pNumber != 0) {
-                    *(--prefixPointer) = (type & upcase) ? 'B' : 'b';
-                    *(--prefixPointer) = '0';
-                }
+        if (set.controls) {
+            unsigned long long del = x ^ (ones * 0x7f);
 
-                break;
+            nasty |= ((x - ones * ' ') & ~x) | ((del - ones) & ~del);
+        }
 
-            case 8:
-                do {
-                    *(--actualPointer) = char((number & 7) + '0');
-                    number >>= 3;
-                } while (number != 0);
+        for (const char* special = set.specials; *special != 0; ++special) {
+            unsigned long long match = x ^ (ones * static_cast<unsigned char>(*special));
 
-                while (actualPointer > precisionPointer) {
-                    *(--actualPointer) = '0';
-                }
+            nasty |= (match - ones) & ~match;
+        }
 
-                prefixPointer = actualPointer;
+        nasty &= highs;
 
-                if (type & alternative) {
-                    if (*actualPointer != '0') {
-                        *(--prefixPointer) = '0';
-                    }
-                }
+        if (nasty != 0) {
+            return pt + __builtin_ctzll(nasty) / 8;
+        }
+    }
+#endif
 
-                break;
+    for (; pt != end; ++pt) {
+        unsigned c = static_cast<unsigned char>(*pt);
+
+        if (c > 0x7f ? set.high : ((set.rows[c & 0xf] >> (c >> 4)) & 1) != 0) {
+            break;
+        }
+    }
 
-            case 16: {
-                const char* lowDigits = "0123456789abcdef";
-                const char* upDigits = "0123456789ABCDEF";
-                const char* digits = (type & upcase) ? upDigits : lowDigits;
+    return pt;
+}
 
-                do {
-                    *(--actualPointer) = digits[number & 15];
-                    number >>= 4;
-                } while (number != 0);
+static char* escapeC(char* dest, char c)
+{
+    dest[0] = '\\';
 
-                while (actualPointer > precisionPointer) {
-                    *(--actualPointer) = '0';
-                }
+    switch (c) {
+        case '\a':
+            dest[1] = 'a';
+            break;
 
-                prefixPointer = actualPointer;
+        case '\b':
+            dest[1] = 'b';
+            break;
 
-                if (type & alternative && pNumber != 0) {
-                    *(--prefixPointer) = (type & upcase) ? 'X' : 'x';
-                    *(--prefixPointer) = '0';
-                }
-            }
+        case '\f':
+            dest[1] = 'f';
+            break;
 
+        case '\n':
+            dest[1] = 'n';
             break;
 
-            case 10: {
-                const char* digitPairs = "0001020304050607080910111213141516171819"
-                                         "2021222324252627282930313233343536373839"
-                                         "4041424344454647484950515253545556575859"
-                                         "6061626364656667686970717273747576777879"
-                                         "8081828384858687888990919293949596979899";
+        case '\r':
+            dest[1] = 'r';
+            break;
 
-                while (unsigned(number) != number) {
-                    unsigned long long q = number / 100;
-                    unsigned long long r = (number % 100) * 2;
+        case '\t':
+            dest[1] = 't';
+            break;
 
-                    *(--actualPointer) = digitPairs[r + 1];
-                    *(--actualPointer) = digitPairs[r];
+        case '\v':
+            dest[1] = 'v';
+            break;
 
-                    number = q;
-                }
+        case '\\':
+        case '\"':
+        case '\'':
+            dest[1] = c;
+            break;
 
-                unsigned uNumber = unsigned(number);
+        default:
+            dest[1] = char(((c >> 6) & 0x3) + '0');
+            dest[2] = char(((c >> 3) & 0x7) + '0');
+            dest[3] = char((c & 0x7) + '0');
+            return dest + 4;
+    }
 
-                while (uNumber >= 100) {
-                    unsigned q = uNumber / 100;
-                    unsigned r = (uNumber % 100) * 2;
+    return dest + 2;
+}
 
-                    *(--actualPointer) = digitPairs[r + 1];
-                    *(--actualPointer) = digitPairs[r];
+static char* escapeJson(char* dest, char c)
+{
+    dest[0] = '\\';
 
-                    uNumber = q;
-                }
+    switch (c) {
+        case '\b':
+            dest[1] = 'b';
+            break;
 
-                if (uNumber >= 10) {
-                    unsigned long long r = uNumber * 2;
+        case '\f':
+            dest[1] = 'f';
+            break;
 
-                    *(--actualPointer) = digitPairs[r + 1];
-                    *(--actualPointer) = digitPairs[r];
-                } else {
-                    *(--actualPointer) = char(uNumber + '0');
-                }
+        case '\n':
+            dest[1] = 'n';
+            break;
 
-                while (actualPointer > precisionPointer) {
-                    *(--actualPointer) = '0';
-                }
+        case '\r':
+            dest[1] = 'r';
+            break;
 
-                prefixPointer = actualPointer;
+        case '\t':
+            dest[1] = 't';
+            break;
 
-                break;
-            }
-        }
-    } else {
-        prefixPointer = actualPointer;
+        case '\\':
+        case '\"':
+            dest[1] = c;
+            break;
 
-        /// This is a hack to overcome an inconsistency between '%.x' and '%.o' formatting.
-        if (base == 8 && (type & alternative)) {
-            *(--prefixPointer) = '0';
-        }
+        default:
+            memcpy(dest + 1, "u00", 3);
+            dest[4] = "0123456789abcdef"[(c >> 4) & 0xf];
+            dest[5] = "0123456789abcdef"[c & 0xf];
+            return dest + 6;
     }
 
-    if (isSigned && sign != 0) {
-        *(--prefixPointer) = sign;
+    return dest + 2;
+}
+
+static char* escapeHtml(char* dest, char c)
+{
+    switch (c) {
+        case '&':
+            return tsioImplementation::copy(dest, "&amp;", 5);
+
+        case '<':
+            return tsioImplementation::copy(dest, "&lt;", 4);
+
+        case '>':
+            return tsioImplementation::copy(dest, "&gt;", 4);
+
+        case '\"':
+            return tsioImplementation::copy(dest, "&quot;", 6);
+
+        default:
+            return tsioImplementation::copy(dest, "&#39;", 5);
     }
+}
 
-    auto& dest = format.dest;
-    size_t bytesNeeded = buf + bufSize - prefixPointer;
+// Write the escaped form of 'text' to 'dest', which has room for
+// 'escapeSizes[mode]' bytes per byte of text.  Clean runs are found and
+// copied in blocks.  At most 'maxSize' bytes are written; an escape that
+// does not fit completely is left out.
+static char* makeNice(char* dest, const char* text, size_t size, EscapeMode mode, size_t maxSize)
+{
+    const char* end = text + size;
+    const char* last = dest + maxSize;
+    const EscapeSet& set = escapeSets[mode];
 
-    if (size_t(size) <= bytesNeeded) {
-        dest.append(prefixPointer, bytesNeeded);
-    } else {
-        char fillCharacter;
+    for (;;) {
+        const char* nasty = findNasty(text, end, set);
+        size_t clean = nasty - text;
 
-        if ((type & (alfafill | numericfill)) == 0) {
-            fillCharacter = ' ';
-        } else if ((type & (numericfill | precisionGiven)) == (numericfill | precisionGiven)) {
-            type &= ~numericfill;
-            fillCharacter = ' ';
-        } else {
-            fillCharacter = state.fillCharacter;
+        if (clean > size_t(last - dest)) {
+            memcpy(dest, text, last - dest);
+            return dest + (last - dest);
         }
 
-        size_t destSize = dest.size();
+        memcpy(dest, text, clean);
+        dest += clean;
 
-        dest.widen(size);
+        if (nasty == end) {
+            return dest;
+        }
 
-        char* pt = dest.data() + destSize;
-        size_t fillSize = size - bytesNeeded;
+        char c = *nasty;
+        char* start = dest;
 
-        if ((type & (leftJustify | centerJustify | numericfill)) == 0) {
-            pt = fill(pt, fillCharacter, fillSize);
-            copy(pt, prefixPointer, bytesNeeded);
-        } else if (type & leftJustify) {
-            pt = copy(pt, prefixPointer, bytesNeeded);
-            fill(pt, fillCharacter, fillSize);
-        } else if (type & centerJustify) {
-            size_t offset = fillSize / 2;
-            size_t rest = size - offset;
+        text = nasty + 1;
 
-            pt = fill(pt, fillCharacter, offset);
-            pt = copy(pt, prefixPointer, bytesNeeded);
-            fill(pt, fillCharacter, rest);
-        } else { // numericFill
-            size_t prefixSize = actualPointer - prefixPointer;
-            auto actualDigits = bytesNeeded - prefixSize;
+        switch (mode) {
+            case dotEscape:
+                *dest++ = '.';
+                break;
 
-            pt = copy(pt, prefixPointer, prefixSize);
-            pt = fill(pt, fillCharacter, fillSize);
-            copy(pt, actualPointer, actualDigits);
+            case cEscape:
+                dest = escapeC(dest, c);
+                break;
+
+            case jsonEscape:
+                dest = escapeJson(dest, c);
+                break;
+
+            case htmlEscape:
+                dest = escapeHtml(dest, c);
+                break;
+
+            case urlEscape:
+                dest[0] = '%';
+                dest[1] = "0123456789ABCDEF"[(c >> 4) & 0xf];
+                dest[2] = "0123456789ABCDEF"[c & 0xf];
+                dest += 3;
+                break;
+
+            default:
+                // a quote in a quoted CSV field
+                *dest++ = c;
+                *dest++ = c;
+        }
+
+        // the room for the whole text also holds this escape
+        if (dest > last) {
+            return start;
         }
     }
 }
 
-void tsioImplementation::outputPointer(Format& format, uintptr_t pNumber)
+// Output 'text' with '%S'.  The escaped text is written straight into the
+// destination and padded in place.  With '#', JSON strings are quoted and CSV
+// fields are always quoted; otherwise only CSV fields that hold a comma, a
+// quote or a line break are.  Width and precision apply to the escaped text,
+// quotes included; the precision only cuts between escapes and never drops
+// the closing quote.
+static void outputNice(tsioImplementation::Format& format, const char* text, size_t size, int maxSize)
 {
+    using namespace tsioImplementation;
+    auto& dest = format.dest;
     auto& state = format.nextNode->state;
+    EscapeMode mode = escapeMode(state);
+    bool quote = false;
 
-    outputNumber<16>(format, pNumber, state.type | alternative);
-}
+    // every byte of text gives at least one byte of output
+    if (size > size_t(maxSize)) {
+        size = maxSize;
+    }
 
-void tsioImplementation::FormatState::parse(const char*& f)
-{
-    const char* format = f;
-    bool startsWithWidth = false;
+    if (mode == jsonEscape) {
+        quote = (state.type & alternative) != 0;
+    } else if (mode == csvEscape) {
+        quote = (state.type & alternative) != 0 || findNasty(text, text + size, escapeSets[csvEscape]) != text + size;
+        mode = csvQuoteEscape;
+    }
 
-    unsigned char ch = *(format++);
+    size_t quotes = quote ? 2 : 0;
+    size_t niceRoom = escapeSizes[mode] * size;
 
-    if (ch >= '1' && ch <= '9') {
-        unsigned number = ch - '0';
+    if (size_t(maxSize) < niceRoom + quotes) {
+        niceRoom = size_t(maxSize) > quotes ? maxSize - quotes : 0;
+    }
 
-        auto pt = format;
+    size_t destSize = dest.size();
+    size_t width = state.width;
+    size_t room = escapeSizes[mode] * size + quotes + width;
 
-        for (; *pt >= '0' && *pt <= '9'; ++pt) {
-            number = number * 10 + (*pt - '0');
-        }
+    dest.widen(room);
 
-        if (*pt == '$') {
-            setPositional();
-            position = number;
-            format = pt + 1;
-        } else {
-            width = number;
-            setWidthGiven();
-            startsWithWidth = true;
-            format = pt;
-        }
+    char* start = dest.data() + destSize;
+    char* pt = start;
 
-        ch = *(format++);
+    if (quote) {
+        *pt++ = '\"';
     }
 
-    if (!startsWithWidth) {
-        auto tmpType = type;
-        char alfaFill = ' ';
-        char numericFill = ' ';
+    pt = makeNice(pt, text, size, mode, niceRoom);
 
-        for (;;) {
-            if (ch == '0') {
-                tmpType |= numericfill;
-                numericFill = '0';
-            } else if (ch == '-') {
-                tmpType |= leftJustify;
-            } else if (ch == '^') {
-                tmpType |= centerJustify;
-            } else if (ch == '+') {
-                tmpType |= plusIfPositive;
-            } else if (ch == ' ') {
-                tmpType |= spaceIfPositive;
-            } else if (ch == '#') {
-                tmpType |= alternative;
-            } else if (ch == '\'') {
-                tmpType |= numericfill;
+    if (quote) {
+        *pt++ = '\"';
+    }
 
-                if (*format != 0) {
-                    numericFill = *(format++);
-                }
-            } else if (ch == '\"') {
-                tmpType |= alfafill;
+    size_t niceSize = pt - start;
+    size_t length = niceSize;
 
-                if (*format != 0) {
-                    alfaFill = *(format++);
-                }
-            } else {
-                break;
-            }
+    if (state.type & columns) {
+        measureColumns(start, niceSize, std::numeric_limits<size_t>::max(), length);
+    }
 
-            ch = *(format++);
+    if (length < width) {
+        unsigned type = state.type;
+        char fillCharacter = (type & alfafill) ? state.fillCharacter : ' ';
+        size_t fillSize = width - length;
+        size_t before = 0;
+
+        if (type & centerJustify) {
+            before = fillSize / 2;
+        } else if ((type & leftJustify) == 0) {
+            before = fillSize;
         }
 
-        if ((tmpType & (plusIfPositive | spaceIfPositive | numericfill | alfafill)) != 0) {
-            if ((tmpType & (plusIfPositive | spaceIfPositive)) == (plusIfPositive | spaceIfPositive)) {
-                tmpType &= ~spaceIfPositive;
-            }
+        memmove(start + before, start, niceSize);
+        fill(start, fillCharacter, before);
+        fill(start + before + niceSize, fillCharacter, fillSize - before);
+        niceSize += fillSize;
+    }
 
-            if ((tmpType & (leftJustify | numericfill)) == (leftJustify | numericfill)) {
-                tmpType &= ~numericfill;
-            }
+    dest.shrink(room - niceSize);
+}
 
-            if ((tmpType & (centerJustify | numericfill)) == (centerJustify | numericfill)) {
-                tmpType &= ~numericfill;
-            }
+static const char digitPairs[] = "0001020304050607080910111213141516171819"
+                                 "2021222324252627282930313233343536373839"
+                                 "4041424344454647484950515253545556575859"
+                                 "6061626364656667686970717273747576777879"
+                                 "8081828384858687888990919293949596979899";
+
+static const unsigned long long powersOf10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull };
+
+// The number of bits gives an estimate of the number of digits (1233 / 4096 ~ log10(2))
+// that is corrected with a single comparison.
+inline TSIO_ALWAYS_INLINE unsigned countDigits(unsigned number)
+{
+    unsigned t = ((32 - __builtin_clz(number | 1)) * 1233) >> 12;
 
-            if ((tmpType & (alfafill | numericfill)) == (alfafill | numericfill)) {
-                tmpType &= ~alfafill;
-            }
+    return t + 1 - ((number | 1) < powersOf10[t]);
+}
 
-            if (tmpType & numericfill) {
-                fillCharacter = numericFill;
-            } else if (tmpType & alfafill) {
-                fillCharacter = alfaFill;
-            }
-        }
+inline TSIO_ALWAYS_INLINE unsigned countDigits(unsigned long long number)
+{
+    unsigned t = ((64 - __builtin_clzll(number | 1)) * 1233) >> 12;
 
-        type = tmpType;
+    return t + 1 - ((number | 1) < powersOf10[t]);
+}
 
-        if (ch == '*') {
-            setWidthDynamic();
-            ch = *(format++);
+inline TSIO_ALWAYS_INLINE void writeDigitPair(char* dest, unsigned pair)
+{
+    memcpy(dest, digitPairs + pair * 2, 2);
+}
 
-            if (unsigned(ch - '0') < 9) {
-                setPositional();
-                widthPosition = unsigned(ch - '0');
-                ch = *(format++);
+// Write the decimal digits of 'number', ending at 'end'.
+inline TSIO_ALWAYS_INLINE void writeDecimal(char* end, unsigned number)
+{
+    while (number >= 100) {
+        unsigned q = number / 100;
 
-                while (unsigned(ch - '0') < 9) {
-                    widthPosition = widthPosition * 10 + (unsigned(ch - '0'));
-                    ch = *(format++);
+        end -= 2;
+        writeDigitPair(end, number - q * 100);
+        number = q;
+    }
+
+    if (number >= 10) {
+        writeDigitPair(end - 2, number);
+    } else {
+        end[-1] = char(number + '0');
+    }
+}
+
+// Write exactly 8 digits, ending at 'end'.
+inline TSIO_ALWAYS_INLINE void writeDecimal8(char* end, unsigned number)
+{
+    unsigned high = number / 10000;
+    unsigned low = number - high * 10000;
+    unsigned q;
+
+    q = low / 100;
+    writeDigitPair(end - 2, low - q * 100);
+    writeDigitPair(end - 4, q);
+    q = high / 100;
+    writeDigitPair(end - 6, high - q * 100);
+    writeDigitPair(end - 8, q);
+}
+
+// 64 bit values are split in 8 digit parts, so most of the work is done
+// with 32 bit arithmetic.
+inline TSIO_ALWAYS_INLINE void writeDecimal(char* end, unsigned long long number)
+{
+    while ((number >> 32) != 0) {
+        unsigned long long q = number / 100000000;
+
+        writeDecimal8(end, unsigned(number - q * 100000000));
+        end -= 8;
+        number = q;
+    }
+
+    writeDecimal(end, unsigned(number));
+}
+
+// Store 8 digit bytes, held in 'digits' with the least significant digit in
+// the lowest byte, in printing order.
+inline TSIO_ALWAYS_INLINE void storeDigits8(char* dest, unsigned long long digits)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    digits = __builtin_bswap64(digits);
+#endif
+    memcpy(dest, &digits, 8);
+}
+
+// Spread the 32 bits of 'number' over 8 bytes, 4 bits each.
+inline TSIO_ALWAYS_INLINE unsigned long long spreadNibbles(unsigned number)
+{
+#ifdef __BMI2__
+    return _pdep_u64(number, 0x0f0f0f0f0f0f0f0full);
+#else
+    unsigned long long x = number;
+
+    x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+    return (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+#endif
+}
+
+// Spread the low 24 bits of 'number' over 8 bytes, 3 bits each.
+inline TSIO_ALWAYS_INLINE unsigned long long spreadTriplets(unsigned number)
+{
+#ifdef __BMI2__
+    return _pdep_u64(number, 0x0707070707070707ull);
+#else
+    unsigned long long x = number & 0xffffff;
+
+    x = (x | (x << 20)) & 0x00000fff00000fffull;
+    x = (x | (x << 10)) & 0x003f003f003f003full;
+    return (x | (x << 5)) & 0x0707070707070707ull;
+#endif
+}
+
+// Spread the low 8 bits of 'number' over 8 bytes, 1 bit each.
+inline TSIO_ALWAYS_INLINE unsigned long long spreadBits(unsigned number)
+{
+#ifdef __BMI2__
+    return _pdep_u64(number, 0x0101010101010101ull);
+#else
+    unsigned long long x = number & 0xff;
+
+    x = (x | (x << 28)) & 0x0000000f0000000full;
+    x = (x | (x << 14)) & 0x0003000300030003ull;
+    return (x | (x << 7)) & 0x0101010101010101ull;
+#endif
+}
+
+// Write all 16 hexadecimal digits of 'number' to 'dest'.
+inline TSIO_ALWAYS_INLINE void writeHex16(char* dest, unsigned long long number, bool up)
+{
+#ifdef __SSSE3__
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+        up ? "0123456789ABCDEF" : "0123456789abcdef"));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i bytes = _mm_cvtsi64_si128(static_cast<long long>(__builtin_bswap64(number)));
+    __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    __m128i low = _mm_and_si128(bytes, mask);
+    __m128i nibbles = _mm_unpacklo_epi8(high, low);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_shuffle_epi8(table, nibbles));
+#else
+    // Nibbles of 10 and up get bit 4 set by adding 6, which selects the
+    // letter offset.
+    const unsigned long long ones = 0x0101010101010101ull;
+    const unsigned long long letterOffset = (up ? 'A' : 'a') - '0' - 10;
+
+    for (int i = 0; i < 2; ++i) {
+        unsigned long long x = spreadNibbles(unsigned(number >> (32 - 32 * i)));
+        unsigned long long letters = ((x + 6 * ones) >> 4) & ones;
+
+        storeDigits8(dest + 8 * i, x + '0' * ones + letters * letterOffset);
+    }
+#endif
+}
+
+inline unsigned long long highBits(unsigned long long)
+{
+    return 0;
+}
+
+#ifdef __SIZEOF_INT128__
+inline unsigned long long highBits(unsigned __int128 number)
+{
+    return static_cast<unsigned long long>(number >> 64);
+}
+#endif
+
+// Write the digits of 'number' in base 2, 8 or 16 to a buffer, ending at
+// 'end'.  Whole groups are converted at once, so up to 7 (binary), 2 (octal)
+// or 15 (hexadecimal) leading zeros are written before the digits.
+template <int base, typename Unsigned>
+inline TSIO_ALWAYS_INLINE void writeRadix(char* end, Unsigned number, bool up)
+{
+    const unsigned long long ones = 0x0101010101010101ull;
+
+    switch (base) {
+        case 2:
+            do {
+                end -= 8;
+                storeDigits8(end, spreadBits(unsigned(number)) + '0' * ones);
+                number >>= 8;
+            } while (number != 0);
+
+            break;
+
+        case 8:
+            do {
+                end -= 8;
+                storeDigits8(end, spreadTriplets(unsigned(number)) + '0' * ones);
+                number >>= 24;
+            } while (number != 0);
+
+            break;
+
+        case 16:
+            writeHex16(end - 16, static_cast<unsigned long long>(number), up);
+
+            if (highBits(number) != 0) {
+                writeHex16(end - 32, highBits(number), up);
+            }
+
+            break;
+    }
+}
+
+// Split off the lowest 19 digit parts of 'number' until the rest fits in 64
+// bits, storing them in 'parts'.  Returns the number of parts.
+inline unsigned splitDecimal(unsigned long long&, unsigned long long*)
+{
+    return 0;
+}
+
+#ifdef __SIZEOF_INT128__
+inline unsigned splitDecimal(unsigned __int128& number, unsigned long long* parts)
+{
+    const unsigned long long divisor = 10000000000000000000ull;
+    unsigned partCount = 0;
+
+    while (highBits(number) != 0) {
+        // Two 128 / 64 bit divisions, each with a quotient that fits in 64
+        // bits, instead of a full 128 bit division.
+        unsigned long long high = highBits(number);
+        unsigned long long low = static_cast<unsigned long long>(number);
+        unsigned long long highQuotient = high / divisor;
+        unsigned long long remainder = high - highQuotient * divisor;
+        unsigned long long lowQuotient;
+
+#if defined(__x86_64__)
+        __asm__("divq %4" : "=a"(lowQuotient), "=d"(remainder) : "a"(low), "d"(remainder), "r"(divisor));
+#else
+        unsigned __int128 rest = (static_cast<unsigned __int128>(remainder) << 64) | low;
+
+        lowQuotient = static_cast<unsigned long long>(rest / divisor);
+        remainder = static_cast<unsigned long long>(rest - static_cast<unsigned __int128>(lowQuotient) * divisor);
+#endif
+        parts[partCount++] = remainder;
+        number = (static_cast<unsigned __int128>(highQuotient) << 64) | lowQuotient;
+    }
+
+    return partCount;
+}
+#endif
+
+// Write exactly 19 digits, ending at 'end'.
+inline void writeDecimal19(char* end, unsigned long long number)
+{
+    unsigned long long q = number / 100000000;
+    unsigned top;
+
+    writeDecimal8(end, unsigned(number - q * 100000000));
+    number = q;
+    q = number / 100000000;
+    writeDecimal8(end - 8, unsigned(number - q * 100000000));
+    top = unsigned(q);
+    writeDigitPair(end - 18, top % 100);
+    end[-19] = char(top / 100 + '0');
+}
+
+// Reserve room in the destination for a number with a prefix of 'prefixSize'
+// characters (sign and radix indicator) and 'digitCount' digits, and write the
+// prefix and the padding.  Returns the position of the first digit.
+static char* layoutNumber(tsioImplementation::Format& format,
+                          const char* prefix,
+                          unsigned prefixSize,
+                          size_t digitCount,
+                          unsigned type)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    auto& dest = format.dest;
+    size_t size = state.width;
+    size_t bytesNeeded = prefixSize + digitCount;
+    size_t destSize = dest.size();
+
+    if (size <= bytesNeeded) {
+        dest.widen(bytesNeeded);
+
+        return copy(dest.data() + destSize, prefix, prefixSize);
+    }
+
+    char fillCharacter;
+
+    if ((type & (alfafill | numericfill)) == 0) {
+        fillCharacter = ' ';
+    } else if ((type & (numericfill | precisionGiven)) == (numericfill | precisionGiven)) {
+        type &= ~numericfill;
+        fillCharacter = ' ';
+    } else {
+        fillCharacter = state.fillCharacter;
+    }
+
+    dest.widen(size);
+
+    char* pt = dest.data() + destSize;
+    size_t fillSize = size - bytesNeeded;
+
+    if ((type & (leftJustify | centerJustify | numericfill)) == 0) {
+        pt = fill(pt, fillCharacter, fillSize);
+        pt = copy(pt, prefix, prefixSize);
+    } else if (type & leftJustify) {
+        pt = copy(pt, prefix, prefixSize);
+        fill(pt + digitCount, fillCharacter, fillSize);
+    } else if (type & centerJustify) {
+        size_t offset = fillSize / 2;
+
+        pt = fill(pt, fillCharacter, offset);
+        pt = copy(pt, prefix, prefixSize);
+        fill(pt + digitCount, fillCharacter, fillSize - offset);
+    } else { // numericFill
+        pt = copy(pt, prefix, prefixSize);
+        pt = fill(pt, fillCharacter, fillSize);
+    }
+
+    return pt;
+}
+
+// Writes digits from right to left, with a separator between groups of
+// 'groupSize' digits.
+struct GroupedWriter
+{
+    GroupedWriter(char* end, char separatorChar, unsigned size)
+        : pt(end), separator(separatorChar), groupSize(size)
+    {
+    }
+
+    void put(char digit)
+    {
+        if (count == groupSize) {
+            *(--pt) = separator;
+            count = 0;
+        }
+
+        *(--pt) = digit;
+        count++;
+    }
+
+    char* pt;
+    char separator;
+    unsigned groupSize;
+    unsigned count = 0;
+};
+
+inline size_t groupedSize(size_t digitCount, unsigned groupSize)
+{
+    return digitCount == 0 ? 0 : digitCount + (digitCount - 1) / groupSize;
+}
+
+// Grouped numbers are zero filled with grouped leading zeros.  Returns the
+// number of leading zeros for 'digitCount' digits after 'prefixSize'
+// characters.  A number never starts with a separator, so the result can be
+// one character wider than the width.
+inline unsigned groupedZeroCount(const tsioImplementation::FormatState& state,
+                                 unsigned type,
+                                 size_t prefixSize,
+                                 unsigned digitCount,
+                                 unsigned zeroCount,
+                                 unsigned groupSize)
+{
+    using namespace tsioImplementation;
+
+    if ((type & (numericfill | precisionGiven)) == numericfill && state.fillCharacter == '0' &&
+        state.widthGiven() && state.width > prefixSize) {
+        size_t size = state.width - prefixSize;
+        size_t digitsNeeded = size - (size - 1) / (groupSize + 1);
+
+        if (digitsNeeded > digitCount + zeroCount) {
+            return unsigned(digitsNeeded - digitCount);
+        }
+    }
+
+    return zeroCount;
+}
+
+template <typename T>
+struct UnsignedOf {
+    typedef typename std::make_unsigned<T>::type type;
+};
+
+#ifdef __SIZEOF_INT128__
+template <>
+struct UnsignedOf<__int128> {
+    typedef unsigned __int128 type;
+};
+#endif
+
+template <int base, bool isSigned, typename Integer>
+static void outputInteger(tsioImplementation::Format& format, Integer pNumber, unsigned type)
+{
+    using namespace tsioImplementation;
+
+    typedef typename UnsignedOf<Integer>::type Unsigned;
+
+    auto& state = format.nextNode->state;
+    Unsigned number = pNumber;
+    unsigned precision = state.precisionGiven() ? state.precision : 1;
+    char prefix[3] = {};
+    unsigned prefixSize = 0;
+    unsigned groupSize = state.groupSize != 0 ? state.groupSize : (base == 2 || base == 16) ? 4 : 3;
+
+    if (isSigned) {
+        if (pNumber < 0) {
+            prefix[prefixSize++] = '-';
+            number = 0 - number;
+        } else if (type & plusIfPositive) {
+            prefix[prefixSize++] = '+';
+        } else if (type & spaceIfPositive) {
+            prefix[prefixSize++] = ' ';
+        }
+    }
+
+    if (base == 10) {
+        unsigned long long parts[2] = {};
+        unsigned partCount = 0;
+        unsigned digitCount = 0;
+
+        if (precision != 0 || number != 0) {
+            partCount = splitDecimal(number, parts);
+
+            auto rest = static_cast<unsigned long long>(number);
+
+            digitCount = (rest >> 32) == 0 ? countDigits(unsigned(rest)) : countDigits(rest);
+            digitCount += 19 * partCount;
+        }
+
+        unsigned zeroCount = precision > digitCount ? precision - digitCount : 0;
+
+        if (type & grouped) {
+            zeroCount = groupedZeroCount(state, type, prefixSize, digitCount, zeroCount, groupSize);
+
+            size_t size = groupedSize(zeroCount + digitCount, groupSize);
+            GroupedWriter writer(layoutNumber(format, prefix, prefixSize, size, type) + size,
+                                 state.groupSeparator,
+                                 groupSize);
+
+            for (unsigned i = 0; i < partCount; ++i) {
+                for (unsigned j = 0; j < 19; ++j, parts[i] /= 10) {
+                    writer.put(char('0' + parts[i] % 10));
                 }
+            }
 
-                if (ch == '$') {
-                    ch = *(format++);
+            auto rest = static_cast<unsigned long long>(number);
+
+            for (unsigned i = 19 * partCount; i < digitCount; ++i, rest /= 10) {
+                writer.put(char('0' + rest % 10));
+            }
+
+            for (unsigned i = 0; i < zeroCount; ++i) {
+                writer.put('0');
+            }
+
+            return;
+        }
+
+        char* pt = layoutNumber(format, prefix, prefixSize, zeroCount + digitCount, type);
+
+        pt = fill(pt, '0', zeroCount) + digitCount;
+
+        for (unsigned i = 0; i < partCount; ++i) {
+            writeDecimal19(pt, parts[i]);
+            pt -= 19;
+        }
+
+        auto rest = static_cast<unsigned long long>(number);
+
+        if (digitCount == 0) {
+            // nothing to do
+        } else if ((rest >> 32) == 0) {
+            writeDecimal(pt, unsigned(rest));
+        } else {
+            writeDecimal(pt, rest);
+        }
+
+        return;
+    }
+
+    const unsigned bitsPerDigit = base == 2 ? 1 : base == 8 ? 3 : 4;
+    const size_t bufSize = 8 * sizeof(Unsigned); // allow for all binary digits
+    char buf[bufSize];
+    unsigned digitCount = 0;
+
+    if (precision != 0 || number != 0) {
+        unsigned long long high = highBits(number);
+        unsigned bitCount = high != 0 ? 128 - __builtin_clzll(high)
+                                      : 64 - __builtin_clzll(static_cast<unsigned long long>(number) | 1);
+
+        digitCount = (bitCount + bitsPerDigit - 1) / bitsPerDigit;
+        writeRadix<base>(buf + bufSize, number, (type & upcase) != 0);
+    }
+
+    const char* actualPointer = buf + bufSize - digitCount;
+    unsigned zeroCount = precision > digitCount ? precision - digitCount : 0;
+
+    if (type & alternative) {
+        if (base == 8) {
+            /// '%#.0o' prints a '0' for the value 0, where '%#.0x' prints nothing.
+            if (zeroCount == 0 && (digitCount == 0 || number != 0)) {
+                prefix[prefixSize++] = '0';
+            }
+        } else if (pNumber != 0) {
+            prefix[prefixSize++] = '0';
+
+            if (base == 16) {
+                prefix[prefixSize++] = (type & upcase) ? 'X' : 'x';
+            } else {
+                prefix[prefixSize++] = (type & upcase) ? 'B' : 'b';
+            }
+        }
+    }
+
+    if (type & grouped) {
+        zeroCount = groupedZeroCount(state, type, prefixSize, digitCount, zeroCount, groupSize);
+
+        size_t size = groupedSize(zeroCount + digitCount, groupSize);
+        GroupedWriter writer(layoutNumber(format, prefix, prefixSize, size, type) + size,
+                             state.groupSeparator,
+                             groupSize);
+
+        for (unsigned i = digitCount; i-- > 0;) {
+            writer.put(actualPointer[i]);
+        }
+
+        for (unsigned i = 0; i < zeroCount; ++i) {
+            writer.put('0');
+        }
+
+        return;
+    }
+
+    char* pt = layoutNumber(format, prefix, prefixSize, zeroCount + digitCount, type);
+
+    pt = fill(pt, '0', zeroCount);
+    copy(pt, actualPointer, digitCount);
+}
+
+template <int base, bool isSigned = false>
+inline void outputNumber(tsioImplementation::Format& format, long long pNumber, unsigned type)
+{
+    outputInteger<base, isSigned>(format, pNumber, type);
+}
+
+static unsigned long long reverseBits(unsigned long long word)
+{
+    word = __builtin_bswap64(word);
+    word = ((word >> 4) & 0x0f0f0f0f0f0f0f0full) | ((word & 0x0f0f0f0f0f0f0f0full) << 4);
+    word = ((word >> 2) & 0x3333333333333333ull) | ((word & 0x3333333333333333ull) << 2);
+    return ((word >> 1) & 0x5555555555555555ull) | ((word & 0x5555555555555555ull) << 1);
+}
+
+// Write the 64 binary or 16 hexadecimal digits of 'word', most significant first.
+static unsigned wordDigits(char* dest, unsigned long long word, bool hex, bool up)
+{
+    const unsigned long long ones = 0x0101010101010101ull;
+
+    if (hex) {
+        writeHex16(dest, word, up);
+        return 16;
+    }
+
+    for (unsigned i = 0; i < 8; ++i) {
+        storeDigits8(dest + 8 * i, spreadBits(unsigned(word >> (56 - 8 * i))) + '0' * ones);
+    }
+
+    return 64;
+}
+
+void tsioImplementation::printfBits(Format& format,
+                                    const unsigned long long* words,
+                                    size_t bitCount,
+                                    bool indexOrder)
+{
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+    unsigned type = state.type;
+    bool hex = spec == 'x' || spec == 'X';
+    bool up = spec == 'X' || spec == 'B';
+    unsigned bitsPerDigit = hex ? 4 : 1;
+    size_t digitCount = (bitCount + bitsPerDigit - 1) / bitsPerDigit;
+    unsigned groupSize = state.groupSize != 0 ? state.groupSize : 4;
+    bool isGrouped = (type & grouped) != 0;
+    size_t wordCount = (bitCount + 63) / 64;
+    char prefix[2];
+    unsigned prefixSize = 0;
+
+    bool isZero = true;
+
+    for (size_t i = 0; i < wordCount && isZero; ++i) {
+        isZero = words[i] == 0;
+    }
+
+    // like an integer, a value of zero gets no prefix
+    if ((type & alternative) && !isZero) {
+        prefix[prefixSize++] = '0';
+        prefix[prefixSize++] = hex ? (up ? 'X' : 'x') : (up ? 'B' : 'b');
+    }
+
+    size_t size = isGrouped ? groupedSize(digitCount, groupSize) : digitCount;
+    char* pt = layoutNumber(format, prefix, prefixSize, size, type & ~precisionGiven);
+    char digits[64];
+
+    if (indexOrder) {
+        // bit 0 first: the digits of the reversed words, from the first word on
+        unsigned count = 0;
+
+        for (size_t i = 0; i < wordCount; ++i) {
+            size_t bits = std::min(size_t(64), bitCount - 64 * i);
+            unsigned n = unsigned((bits + bitsPerDigit - 1) / bitsPerDigit);
+
+            wordDigits(digits, reverseBits(words[i]), hex, up);
+
+            if (!isGrouped) {
+                pt = copy(pt, digits, n);
+                continue;
+            }
+
+            for (unsigned j = 0; j < n; ++j) {
+                if (count == groupSize) {
+                    *pt++ = state.groupSeparator;
+                    count = 0;
                 }
+
+                *pt++ = digits[j];
+                count++;
+            }
+        }
+    } else {
+        // the highest bit first, so the digits are written from the last word on
+        GroupedWriter writer(pt + size, state.groupSeparator, groupSize);
+
+        for (size_t i = 0; i < wordCount; ++i) {
+            size_t bits = std::min(size_t(64), bitCount - 64 * i);
+            unsigned n = unsigned((bits + bitsPerDigit - 1) / bitsPerDigit);
+            unsigned blockSize = wordDigits(digits, words[i], hex, up);
+
+            if (!isGrouped) {
+                writer.pt -= n;
+                copy(writer.pt, digits + blockSize - n, n);
+                continue;
             }
+
+            for (unsigned j = blockSize; j-- > blockSize - n;) {
+                writer.put(digits[j]);
+            }
+        }
+    }
+}
+
+void tsioImplementation::outputPointer(Format& format, uintptr_t pNumber)
+{
+    auto& state = format.nextNode->state;
+
+    outputNumber<16>(format, pNumber, state.type | alternative);
+}
+
+void tsioImplementation::FormatState::parse(const char*& f)
+{
+    const char* format = f;
+    bool startsWithWidth = false;
+
+    unsigned char ch = *(format++);
+
+    if (ch >= '1' && ch <= '9') {
+        unsigned number = ch - '0';
+
+        auto pt = format;
+
+        for (; *pt >= '0' && *pt <= '9'; ++pt) {
+            number = number * 10 + (*pt - '0');
+        }
+
+        if (*pt == '$') {
+            setPositional();
+            position = number;
+            format = pt + 1;
         } else {
-            if (unsigned(ch - '0') < 9) {
-                setWidthGiven();
-                width = unsigned(ch - '0');
-                ch = *(format++);
+            width = number;
+            setWidthGiven();
+            startsWithWidth = true;
+            format = pt;
+        }
+
+        ch = *(format++);
+    }
+
+    if (!startsWithWidth) {
+        auto tmpType = type;
+        char alfaFill = ' ';
+        char numericFill = ' ';
+
+        for (;;) {
+            if (ch == '0') {
+                tmpType |= numericfill;
+                numericFill = '0';
+            } else if (ch == '-') {
+                tmpType |= leftJustify;
+            } else if (ch == '^') {
+                tmpType |= centerJustify;
+            } else if (ch == '+') {
+                tmpType |= plusIfPositive;
+            } else if (ch == ' ') {
+                tmpType |= spaceIfPositive;
+            } else if (ch == '#') {
+                tmpType |= alternative;
+            } else if (ch == '\'') {
+                tmpType |= numericfill;
+
+                if (*format != 0) {
+                    numericFill = *(format++);
+                }
+            } else if (ch == '\"') {
+                tmpType |= alfafill;
+
+                if (*format != 0) {
+                    alfaFill = *(format++);
+                }
+            } else if (ch == ',') {
+                tmpType |= grouped;
+                groupSeparator = ',';
+            } else if (ch == '=') {
+                tmpType |= grouped;
+
+                if (*format != 0) {
+                    groupSeparator = *(format++);
+                }
+            } else if (ch == '!') {
+                tmpType |= shortest;
+            } else if (ch == '~') {
+                tmpType |= columns;
+            } else if (ch == '&' && (*format == 'j' || *format == 'c' || *format == 'h' || *format == 'u')) {
+                escape = *(format++);
+            } else if (ch == ':' && (tmpType & grouped) && *format >= '1' && *format <= '9') {
+                groupSize = *(format++) - '0';
+            } else {
+                break;
+            }
+
+            ch = *(format++);
+        }
+
+        if ((tmpType & (plusIfPositive | spaceIfPositive | numericfill | alfafill)) != 0) {
+            if ((tmpType & (plusIfPositive | spaceIfPositive)) == (plusIfPositive | spaceIfPositive)) {
+                tmpType &= ~spaceIfPositive;
+            }
+
+            if ((tmpType & (leftJustify | numericfill)) == (leftJustify | numericfill)) {
+                tmpType &= ~numericfill;
+            }
+
+            if ((tmpType & (centerJustify | numericfill)) == (centerJustify | numericfill)) {
+                tmpType &= ~numericfill;
+            }
+
+            if ((tmpType & (alfafill | numericfill)) == (alfafill | numericfill)) {
+                tmpType &= ~alfafill;
+            }
+
+            if (tmpType & numericfill) {
+                fillCharacter = numericFill;
+            } else if (tmpType & alfafill) {
+                fillCharacter = alfaFill;
+            }
+        }
+
+        type = tmpType;
+
+        if (ch == '*') {
+            setWidthDynamic();
+            ch = *(format++);
+
+            if (unsigned(ch - '0') <= 9) {
+                setPositional();
+                widthPosition = unsigned(ch - '0');
+                ch = *(format++);
+
+                while (unsigned(ch - '0') <= 9) {
+                    widthPosition = widthPosition * 10 + (unsigned(ch - '0'));
+                    ch = *(format++);
+                }
+
+                if (ch == '$') {
+                    ch = *(format++);
+                }
+            }
+        } else {
+            if (unsigned(ch - '0') <= 9) {
+                setWidthGiven();
+                width = unsigned(ch - '0');
+                ch = *(format++);
+
+                while (unsigned(ch - '0') <= 9) {
+                    width = width * 10 + (unsigned(ch - '0'));
+                    ch = *(format++);
+                }
+            }
+        }
+    }
+
+    if (ch == '.') {
+        ch = *(format++);
+        setPrecisionGiven();
+
+        if (ch == '*') {
+            setPrecisionDynamic();
+            ch = *(format++);
+
+            if (unsigned(ch - '0') <= 9) {
+                setPositional();
+                precisionPosition = unsigned(ch - '0');
+                ch = *(format++);
+
+                while (unsigned(ch - '0') <= 9) {
+                    precisionPosition = precisionPosition * 10 + (unsigned(ch - '0'));
+                    ch = *(format++);
+                }
+
+                if (ch == '$') {
+                    ch = *(format++);
+                }
+            }
+        }
+        if (unsigned(ch - '0') <= 9) {
+            precision = unsigned(ch - '0');
+
+            ch = *(format++);
+
+            while (unsigned(ch - '0') <= 9) {
+                precision = precision * 10 + (unsigned(ch - '0'));
+                ch = *(format++);
+            }
+        }
+    }
+
+    while (ch == 'h' || ch == 'j' || ch == 'l' || ch == 'L' || ch == 't' || ch == 'z') {
+        ch = *(format++);
+    }
+
+    formatSpecifier = ch;
+    if (ch == 0) {
+        f = format - 1;
+        setSpecial();
+    } else {
+        if (ch == '%' || ch == 'T' || ch == '{' || ch == '}' || ch == 'N') {
+            setSpecial();
+        }
+
+        f = format;
+    }
+}
+
+const char* tsioImplementation::FormatState::unParseForFloat(char* buf, bool longDouble) const
+{
+    // the string is built back to front.
+    char* pt = buf + 30;
+
+    *pt = 0;
+
+    *(--pt) = (formatSpecifier == 's') ? 'g' : formatSpecifier;
+
+    if (longDouble) {
+        *(--pt) = 'L';
+    }
+
+    if (precisionGiven()) {
+        if (widthDynamic()) {
+            *(--pt) = '*';
+        } else {
+            unsigned tmp = precision;
+
+            do {
+                unsigned q = tmp / 10;
+                unsigned r = tmp - q * 10;
+
+                *(--pt) = char(r + '0');
+                tmp = q;
+            } while (tmp != 0);
+        }
+
+        *(--pt) = '.';
+    }
+
+    // width is defaulted
+    // Only some flags are returned.
+
+    if (type != 0) {
+        if (type & plusIfPositive) {
+            *(--pt) = '+';
+        }
+
+        if (type & spaceIfPositive) {
+            *(--pt) = ' ';
+        }
+
+        if (type & alternative) {
+            *(--pt) = '#';
+        }
+    }
+
+    *(--pt) = '%';
+
+    return pt;
+}
+
+void tsioImplementation::Format::showErrorContext(FormatNode* node) const
+{
+    std::cerr << "         at \"" << wholeFormat << "\"\n";
+
+    size_t offset;
+
+    if (node == nullptr) {
+        offset = strlen(wholeFormat);
+    } else {
+        offset = node->format - wholeFormat + node->state.prefixSize;
+    }
+
+    std::cerr << std::setw(offset + 12 + 2) << '^' << std::endl;
+}
+
+tsioImplementation::FormatNode* tsioImplementation::Format::getNode()
+{
+    if (chuncks->index == chuncks->chunckSize - 1) {
+        auto pt = new FormatNodes;
+
+        pt->next = chuncks;
+        chuncks = pt;
+    }
+
+    auto result = &chuncks->nodes[chuncks->index++];
+    result->reset();
+    result->format = format;
+    return result;
+}
+
+tsioImplementation::FormatNode* tsioImplementation::Format::buildTree(unsigned depth)
+{
+
+    if (*format == 0) {
+        return nullptr;
+    }
+
+    FormatNode* node = getNode();
+    FormatNode* result = node;
+    FormatNode* next = node;
+
+    for (;;) {
+        auto& state = node->state;
+        const char* fmt = format;
+
+        state.start = fmt;
+        state.prefix = fmt;
+        while (*fmt != 0 && *fmt != '%') {
+            fmt++;
+        }
+
+        if (*fmt == 0) {
+            state.prefixSize = unsigned(fmt - state.prefix);
+            state.setSpecial();
+            state.size = fmt - format;
+            break;
+        }
+
+        state.prefixSize = unsigned(fmt - state.prefix);
+        fmt++;
+        state.parse(fmt);
+        state.size = fmt - format;
+
+        if (state.formatSpecifier == 0) {
+            error("Incomplete format");
+        }
+
+        format = fmt;
+        if (state.positional()) {
+            positional = true;
+        }
+
+        auto spec = state.formatSpecifier;
+
+        if (spec == '}' || spec == ']' || spec == '>' || spec == ')') {
+            if (depth == 0) {
+                error(node, "non matching '%", spec, "'");
+            }
+
+            break;
+        }
+
+        if (spec == '{' || spec == '[') {
+            node->child = buildTree(depth + 1);
+        } else if (spec == '<') {
+            bool parentPositional = positional;
+
+            positional = false;
+
+            node->child = buildTree(depth + 1);
+
+            if (positional) {
+                state.setPositionalChildren();
+            }
+
+            positional = parentPositional;
+        } else if (spec == '(') {
+            bool parentPositional = positional;
+
+            positional = false;
+
+            node->child = buildTree(depth + 1);
+
+            if (positional) {
+                state.setPositionalChildren();
+            }
+
+            positional = parentPositional;
+        }
+
+        if (*fmt == 0) {
+            break;
+        }
+
+        node = getNode();
+        next->next = node;
+        next = node;
+    }
+
+    return result;
+}
+
+void tsioImplementation::Format::tabTo(unsigned column, bool absolute)
+{
+    const char* nlPointer = dest.data() + dest.size();
+
+    while (nlPointer > dest.data() && nlPointer[-1] != '\n') {
+        --nlPointer;
+    }
+
+    size_t currentColumn = dest.data() + dest.size() - nlPointer;
+
+    if (absolute) {
+        column--;
+
+        if (currentColumn < column) {
+            dest.append(column - currentColumn, ' ');
+        } else {
+            dest.push_back('\n');
+            dest.append(column, ' ');
+        }
+    } else {
+        auto delta = column - (currentColumn % column);
+        if (delta == 0) {
+            delta = column;
+        }
+
+        dest.append(delta, ' ');
+    }
+}
+
+void tsioImplementation::Format::handleSpecialNodes(FormatNode*& node)
+{
+    auto& state = node->state;
+    auto spec = state.formatSpecifier;
+
+    dest.append(state.prefix, state.prefixSize);
+
+    if (spec == 0) {
+        node = node->next;
+    }
+    if (spec == '%') {
+        dest.push_back('%');
+        node = node->next;
+    } else if (spec == 'T') {
+        tabTo(state.width, state.type & alternative);
+        node = node->next;
+    } else if (spec == 'N') {
+        if (indexStack.empty()) {
+            error("%N format is only valid inside rpeatimg, range and element formats");
+        } else {
+            auto index = indexStack.back();
+
+            if (!(state.type & alternative)) {
+                index++;
+            }
+
+            auto tmpNode = nextNode;
+
+            nextNode = node;
+            outputNumber<10>(*this, index, state.type);
+            nextNode = tmpNode;
+        }
+
+
+        node = node->next;
+    } else if (spec == '{') {
+        auto child = node->child;
+
+        if (child == nullptr) {
+            error("Missing format");
+            node = nullptr;
+        } else if (child->next == nullptr && child->state.formatSpecifier == '}') {
+            for (unsigned i = 0, c = state.width; i < c; ++i) {
+                dest.append(child->state.prefix, child->state.prefixSize);
+            }
+
+            node = node->next;
+        } else {
+            pushRepeat(node, state.width);
+            indexStack.push_back(0);
+            node = child;
+        }
+    } else if (spec == '}') {
+        if (!repeatStack.empty()) {
+            auto& element = repeatStack.back();
+
+            if ((element.count--) == 0) {
+                node = element.node->next;
+                repeatStack.pop_back();
+                indexStack.pop_back();
+            } else {
+                node = element.node->child;
+                indexStack.back()++;
+            }
+        } else {
+            node = node->next;
+        }
+    }
+}
+
+tsioImplementation::FormatNode* tsioImplementation::Format::getNextSibling(FormatNode* node, bool first)
+{
+    if (node == nullptr) {
+        return node;
+    }
+
+    if (!first) {
+        node = node->next;
+    }
+
+    while (node != nullptr && node->state.nonDynamicSpecial()) {
+        handleSpecialNodes(node);
+    }
+
+    return node;
+}
+
+std::tuple<char, unsigned> tsioImplementation::Format::getNextSiblingSpecAndType(FormatNode* node)
+{
+    if (node != nullptr) {
+        node = node->next;
+
+        while (node != nullptr && node->state.nonDynamicSpecial()) {
+            node = node->next;
+        }
+    }
+
+    if (node == nullptr) {
+        return { '\0' , 0u };
+    } else {
+        return { node->state.formatSpecifier, node->state.type };
+    }
+}
+
+tsioImplementation::FormatNode* tsioImplementation::Format::getChild(FormatNode* node)
+{
+    auto child = node->child;
+
+    if (child != nullptr) {
+        auto& state = child->state;
+
+        if (state.nonDynamicSpecial()) {
+            return getNextSibling(child, true);
+        }
+    }
+
+    return child;
+}
+
+void tsioImplementation::Format::getNextNode(bool first)
+{
+    if (nextNode == nullptr) {
+        return;
+    }
+
+    if (!first) {
+        nextNode = nextNode->next;
+    }
+
+    while (nextNode != nullptr && nextNode->state.nonDynamicSpecial()) {
+        handleSpecialNodes(nextNode);
+    }
+}
+
+void tsioImplementation::Format::printTree(std::ostream& os, FormatNode* node, unsigned indent)
+{
+    const auto& state = node->state;
+
+    for (unsigned i = 0; i < indent; ++i) {
+        os << "  ";
+    }
+
+    os << '"';
+    os.write(state.start, state.size);
+    os << '"';
+
+    os << '\n';
+
+    auto child = node->child;
+
+    while (child != nullptr) {
+        printTree(os, child, indent + 1);
+
+        child = child->next;
+    }
+}
+
+void tsioImplementation::Format::dump()
+{
+    for (auto node = nextNode; node != 0; node = node->next) {
+        printTree(std::cout, node, 0);
+    }
+}
+
+void tsio::fmt::initialize(const char* format)
+{
+    state.reset();
+
+    if (format == 0) {
+        return;
+    }
+
+    if (*format == '%') {
+        format++;
+    }
+
+    state.parse(format);
+}
+
+template <typename Integer>
+static void printfIntegral(tsioImplementation::Format& format,
+                           Integer sValue,
+                           typename UnsignedOf<Integer>::type uValue,
+                           bool isSigned)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+
+    auto type = state.type;
+
+    // let's favor the most used formats
+    if (spec == 'd' || spec == 'i') {
+        if (sValue > 0 && (type & (plusIfPositive | spaceIfPositive)) == 0) {
+            outputInteger<10, false, Integer>(format, uValue, type);
+            return;
+        }
+
+        outputInteger<10, true>(format, sValue, type);
+        return;
+    } else if (spec == 'u') {
+        outputInteger<10, false, Integer>(format, uValue, type);
+        return;
+    }
+
+    switch (spec) {
+        case 'X':
+            outputInteger<16, false, Integer>(format, uValue, type | upcase);
+            return;
+
+        case 'B':
+            outputInteger<2, false, Integer>(format, uValue, type | upcase);
+            return;
+
+        case 'C': {
+            char c = char(sValue);
+
+            outputNice(format,
+                       &c,
+                       1,
+                       state.precisionGiven() ? (state.precision > 0 ? state.precision : 1)
+                                              : std::numeric_limits<int>::max());
+            return;
+        }
+
+        case 'b':
+            outputInteger<2, false, Integer>(format, uValue, type);
+            return;
+
+        case 'c': {
+            char c = char(sValue);
+            outputString(format,
+                         &c,
+                         1,
+                         state.precisionGiven() ? (state.precision > 0 ? state.precision : 1)
+                                                : std::numeric_limits<int>::max());
+            return;
+        }
+
+        case 'n':
+            format.error("The %n formmat requires a pointer to integral argument");
+            return;
+
+        case 'o':
+            outputInteger<8, false, Integer>(format, uValue, type);
+            return;
+
+        case 's':
+            if (isSigned) {
+                outputInteger<10, true>(format, sValue, type);
+            } else {
+                outputInteger<10, false, Integer>(format, uValue, type);
+            }
+
+            return;
+
+        case 'x':
+            outputInteger<16, false, Integer>(format, uValue, type);
+            return;
+    }
+
+    format.error("Invalid format '", spec, "' for integeral value");
+}
+
+void tsioImplementation::printfDetail(Format& format,
+                                      long long sValue,
+                                      unsigned long long uValue,
+                                      bool isSigned)
+{
+    printfIntegral(format, sValue, uValue, isSigned);
+}
+
+// Format a run of integers with the current node.  Plain decimal formats are
+// written straight into space reserved for a chunk of elements; all other
+// formats go through printfIntegral for each element.
+template <typename Element>
+static void printfIntegerRun(tsioImplementation::Format& format,
+                             const Element* data,
+                             size_t count,
+                             const tsioImplementation::FormatState* separator,
+                             bool lastSeparator)
+{
+    using namespace tsioImplementation;
+
+    typedef typename std::make_signed<Element>::type Signed;
+    typedef typename std::make_unsigned<Element>::type Unsigned;
+
+    auto& state = format.nextNode->state;
+    auto& dest = format.dest;
+    char spec = state.formatSpecifier;
+    unsigned type = state.type;
+    bool isSigned = std::is_signed<Element>::value;
+    const char* prefix = separator ? state.prefix : nullptr;
+    unsigned prefixSize = separator ? state.prefixSize : 0;
+    const char* separatorText = separator ? separator->prefix : nullptr;
+    unsigned separatorSize = separator ? separator->prefixSize : 0;
+    bool signedView = spec == 'd' || spec == 'i' || (spec == 's' && isSigned);
+    const unsigned fancy = alfafill | numericfill | centerJustify | precisionGiven |
+                           plusIfPositive | spaceIfPositive | grouped;
+
+    if ((signedView || spec == 'u' || spec == 's') && (type & fancy) == 0) {
+        const size_t chunkSize = 256;
+        size_t width = state.widthGiven() ? state.width : 0;
+        size_t elementSize = prefixSize + std::max(width, size_t(21)) + separatorSize;
+        bool left = (type & leftJustify) != 0;
+
+        for (size_t i = 0; i < count; i += chunkSize) {
+            size_t n = std::min(chunkSize, count - i);
+            size_t start = dest.size();
+
+            dest.widen(n * elementSize);
+
+            char* pt = dest.data() + start;
+
+            for (size_t j = i; j < i + n; ++j) {
+                bool negative = signedView && Signed(data[j]) < 0;
+                unsigned long long number = negative ? 0 - static_cast<unsigned long long>(Signed(data[j]))
+                                                     : static_cast<unsigned long long>(Unsigned(data[j]));
+                unsigned digitCount = (number >> 32) == 0 ? countDigits(unsigned(number))
+                                                          : countDigits(number);
+                size_t size = digitCount + negative;
+                unsigned padding = width > size ? unsigned(width - size) : 0;
+
+                pt = copy(pt, prefix, prefixSize);
+
+                if (!left) {
+                    pt = fill(pt, ' ', padding);
+                }
+
+                *pt = '-';
+                pt += negative + digitCount;
+
+                if ((number >> 32) == 0) {
+                    writeDecimal(pt, unsigned(number));
+                } else {
+                    writeDecimal(pt, number);
+                }
+
+                if (left) {
+                    pt = fill(pt, ' ', padding);
+                }
+
+                if (j + 1 < count || lastSeparator) {
+                    pt = copy(pt, separatorText, separatorSize);
+                }
+            }
+
+            dest.shrink(size_t(dest.data() + dest.size() - pt));
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        dest.append(prefix, prefixSize);
+        printfIntegral<long long>(format, Signed(data[i]), Unsigned(data[i]), isSigned);
+
+        if (separator != nullptr && (i + 1 < count || lastSeparator)) {
+            dest.append(separatorText, separatorSize);
+        }
+    }
+}
+
+void tsioImplementation::printfIntegers(Format& format,
+                                        const void* data,
+                                        size_t count,
+                                        unsigned elementSize,
+                                        bool isSigned,
+                                        const FormatState* separator,
+                                        bool lastSeparator)
+{
+    switch (elementSize * 2 + isSigned) {
+        case 2:
+            printfIntegerRun(format, static_cast<const uint8_t*>(data), count, separator, lastSeparator);
+            break;
+        case 3:
+            printfIntegerRun(format, static_cast<const int8_t*>(data), count, separator, lastSeparator);
+            break;
+        case 4:
+            printfIntegerRun(format, static_cast<const uint16_t*>(data), count, separator, lastSeparator);
+            break;
+        case 5:
+            printfIntegerRun(format, static_cast<const int16_t*>(data), count, separator, lastSeparator);
+            break;
+        case 8:
+            printfIntegerRun(format, static_cast<const uint32_t*>(data), count, separator, lastSeparator);
+            break;
+        case 9:
+            printfIntegerRun(format, static_cast<const int32_t*>(data), count, separator, lastSeparator);
+            break;
+        case 16:
+            printfIntegerRun(format, static_cast<const uint64_t*>(data), count, separator, lastSeparator);
+            break;
+        case 17:
+            printfIntegerRun(format, static_cast<const int64_t*>(data), count, separator, lastSeparator);
+            break;
+    }
+}
+
+#ifdef __SIZEOF_INT128__
+void tsioImplementation::printfDetail(Format& format, __int128 value)
+{
+    printfIntegral<__int128>(format, value, value, true);
+}
+
+void tsioImplementation::printfDetail(Format& format, unsigned __int128 value)
+{
+    printfIntegral<__int128>(format, value, value, false);
+}
+#endif
+
+#ifdef __SSSE3__
+// Write 8 bytes as 24 characters "xx xx ... xx " to 'dest', which has room
+// for 32.
+inline TSIO_ALWAYS_INLINE void writeHexBytes8(char* dest, const unsigned char* bytes)
+{
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>("0123456789abcdef"));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i space = _mm_set1_epi8(' ');
+    // index -1 selects a zero, which becomes a space
+    const __m128i first = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i second = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes));
+    __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), mask);
+    __m128i low = _mm_and_si128(value, mask);
+    __m128i digits = _mm_shuffle_epi8(table, _mm_unpacklo_epi8(high, low));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_max_epu8(_mm_shuffle_epi8(digits, first), space));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 16), _mm_max_epu8(_mm_shuffle_epi8(digits, second), space));
+}
+#endif
+
+// Write the offset of a hex dump line: at least 8 hexadecimal digits.
+static char* writeDumpOffset(char* pt, unsigned long long offset)
+{
+    char digits[16];
+    unsigned digitCount = 8;
+
+    while (digitCount < 16 && (offset >> (4 * digitCount)) != 0) {
+        digitCount++;
+    }
+
+    writeHex16(digits, offset, false);
+
+    return tsioImplementation::copy(pt, digits + 16 - digitCount, digitCount);
+}
+
+// Write a line of a hex dump for 'count' bytes at 'line': the offset, the
+// bytes in hexadecimal and the printable bytes between bars.  Whole groups
+// of 8 bytes are converted at once.  'pt' has room for 16 bytes more than
+// the line takes.
+static char* writeDumpLine(char* pt,
+                           const unsigned char* line,
+                           size_t count,
+                           unsigned long long offset,
+                           size_t lineSize,
+                           size_t groupSize)
+{
+    size_t i = 0;
+
+    pt = writeDumpOffset(pt, offset);
+    *pt++ = ' ';
+    *pt++ = ' ';
+
+#ifdef __SSSE3__
+    if (groupSize % 8 == 0) {
+        for (; count - i >= 8; i += 8) {
+            writeHexBytes8(pt, line + i);
+            pt += 24;
+
+            if ((i + 8) % groupSize == 0 && i + 8 < lineSize) {
+                *pt++ = ' ';
+            }
+        }
+    }
+#endif
+
+    for (; i < lineSize; ++i) {
+        if (i < count) {
+            pt[0] = "0123456789abcdef"[line[i] >> 4];
+            pt[1] = "0123456789abcdef"[line[i] & 0xf];
+        } else {
+            pt[0] = ' ';
+            pt[1] = ' ';
+        }
+
+        pt[2] = ' ';
+        pt += 3;
+
+        if ((i + 1) % groupSize == 0 && i + 1 < lineSize) {
+            *pt++ = ' ';
+        }
+    }
+
+    *pt++ = ' ';
+    *pt++ = '|';
+    i = 0;
+
+#ifdef __SSE2__
+    const __m128i lastControl = _mm_set1_epi8(0x1f);
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i dot = _mm_set1_epi8('.');
+
+    for (; count - i >= 16; i += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + i));
+        __m128i printable = _mm_andnot_si128(_mm_cmpeq_epi8(value, del), _mm_cmpgt_epi8(value, lastControl));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pt + i),
+                         _mm_or_si128(_mm_and_si128(printable, value), _mm_andnot_si128(printable, dot)));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        unsigned char c = line[i];
+
+        pt[i] = c >= ' ' && c <= '~' ? char(c) : '.';
+    }
+
+    pt += count;
+    *pt++ = '|';
+    *pt++ = '\n';
+
+    return pt;
+}
+
+// Output the next 'size' bytes of 'dump' with '%D', as 'hexdump -C' does: a
+// line that repeats the previous full line is shown as a single '*' line,
+// and the last piece ends with the offset after the last byte.  The width
+// sets the number of bytes per line (16) and the precision the number of
+// bytes per group of hexadecimal columns (8).  A partial line is kept until
+// the next piece or the end.
+static void outputDump(tsioImplementation::Format& format,
+                       const unsigned char* bytes,
+                       size_t size,
+                       bool last,
+                       tsioImplementation::DumpState& dump)
+{
+    auto& dest = format.dest;
+    auto& state = format.nextNode->state;
+    size_t lineSize = state.width > 0 ? state.width : 16;
+    size_t groupSize = state.precisionGiven() && state.precision > 0 ? state.precision : 8;
+
+    if (groupSize > lineSize) {
+        groupSize = lineSize;
+    }
+
+    size_t maxLineSize = 16 + 2 + 3 * lineSize + (lineSize - 1) / groupSize + 2 + lineSize + 2;
+    size_t room = ((dump.pending.size() + size) / lineSize + 2) * maxLineSize + 16;
+    size_t destSize = dest.size();
+
+    dest.widen(room);
+
+    char* pt = dest.data() + destSize;
+    const unsigned char* previous = nullptr;
+    bool previousInPiece = false;
+
+    if (dump.previous.size() == lineSize) {
+        previous = reinterpret_cast<const unsigned char*>(dump.previous.data());
+    }
+
+    // complete the line left by the previous piece
+    if (!dump.pending.empty()) {
+        size_t take = lineSize - dump.pending.size() < size ? lineSize - dump.pending.size() : size;
+
+        dump.pending.append(reinterpret_cast<const char*>(bytes), take);
+        bytes += take;
+        size -= take;
+
+        if (dump.pending.size() == lineSize || last) {
+            const unsigned char* line = reinterpret_cast<const unsigned char*>(dump.pending.data());
+
+            if (previous != nullptr && dump.pending.size() == lineSize && memcmp(line, previous, lineSize) == 0) {
+                if (!dump.repeating) {
+                    pt = tsioImplementation::copy(pt, "*\n", 2);
+                    dump.repeating = true;
+                }
+            } else {
+                pt = writeDumpLine(pt, line, dump.pending.size(), dump.offset, lineSize, groupSize);
+                dump.repeating = false;
+            }
+
+            dump.offset += dump.pending.size();
+            dump.previous.swap(dump.pending);
+            dump.pending.clear();
+            previous = reinterpret_cast<const unsigned char*>(dump.previous.data());
+        }
+    }
+
+    for (; size >= lineSize; bytes += lineSize, size -= lineSize) {
+        if (previous != nullptr && memcmp(bytes, previous, lineSize) == 0) {
+            if (!dump.repeating) {
+                pt = tsioImplementation::copy(pt, "*\n", 2);
+                dump.repeating = true;
+            }
+        } else {
+            pt = writeDumpLine(pt, bytes, lineSize, dump.offset, lineSize, groupSize);
+            dump.repeating = false;
+        }
+
+        dump.offset += lineSize;
+        previous = bytes;
+        previousInPiece = true;
+    }
+
+    if (previousInPiece) {
+        dump.previous.assign(reinterpret_cast<const char*>(previous), lineSize);
+    }
+
+    if (size != 0) {
+        if (last) {
+            pt = writeDumpLine(pt, bytes, size, dump.offset, lineSize, groupSize);
+            dump.offset += size;
+        } else {
+            dump.pending.assign(reinterpret_cast<const char*>(bytes), size);
+        }
+    }
+
+    if (last) {
+        if (dump.offset != 0) {
+            pt = writeDumpOffset(pt, dump.offset);
+            *pt++ = '\n';
+        }
+
+        dump.offset = 0;
+        dump.previous.clear();
+        dump.repeating = false;
+    }
+
+    dest.shrink(dest.data() + destSize + room - pt);
+}
+
+void tsioImplementation::printfHexDump(Format& format, const void* data, size_t size)
+{
+    DumpState dump;
+
+    outputDump(format, static_cast<const unsigned char*>(data), size, true, dump);
+}
+
+void tsioImplementation::printfDetail(Format& format, const tsio::HexDumpPiece& value)
+{
+    if (format.nextNode->state.formatSpecifier != 'D') {
+        format.error("Invalid format '", format.nextNode->state.formatSpecifier, "' for hex dump");
+        return;
+    }
+
+    outputDump(format, value.bytes, value.size, value.last, *value.state);
+}
+
+void tsioImplementation::printfString(Format& format, const char* value, size_t size)
+{
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+
+    switch (spec) {
+        case 's':
+            outputString(format,
+                         value,
+                         size,
+                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+
+            break;
+
+        case 'S':
+            outputNice(format,
+                       value,
+                       size,
+                       state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+
+            break;
+
+        case 'D':
+            printfHexDump(format, value, size);
+            break;
+
+        default:
+            for (size_t i = 0; i < size; ++i) {
+                printfDetail(format, value[i]);
+            }
+    }
+}
+
+void tsioImplementation::printfDetail(Format& format, const std::string& value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+void tsioImplementation::printfDetail(Format& format, const char* value)
+{
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+    uintptr_t pValue = uintptr_t(value);
+
+    switch (spec) {
+        case 'p':
+            outputPointer(format, pValue);
+
+            break;
+
+        case 's':
+            outputString(format,
+                         value,
+                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+
+            break;
+
+        case 'S': {
+            int maxSize = state.precisionGiven() ? state.precision : std::numeric_limits<int>::max();
+
+            outputNice(format, value, strnlen(value, maxSize), maxSize);
+
+            break;
+        }
+
+        case 'D':
+            printfHexDump(format, value, strlen(value));
+            break;
+
+        default:
+            while (*value != 0) {
+                printfDetail(format, *(value++));
+            }
+    }
+}
+
+// Transcode 'text' to UTF-8 at 'dest': UTF-16 for 2 byte characters, UTF-32
+// otherwise.  'dest' has room for 3 bytes per UTF-16 unit or 4 per UTF-32
+// unit.  At most 'maxCount' code points are converted; their number is
+// returned in 'count'.  Unpaired surrogates and values above 0x10ffff
+// become U+FFFD.
+template <typename Char>
+static char* transcode(char* dest, const Char* text, size_t size, size_t maxCount, size_t& count)
+{
+    const Char* end = text + size;
+    size_t done = 0;
+
+#ifdef __SSE2__
+    const __m128i nonAscii = sizeof(Char) == 2 ? _mm_set1_epi16(-0x80) : _mm_set1_epi32(-0x80);
+    const __m128i zero = _mm_setzero_si128();
+#endif
+
+    for (;;) {
+#ifdef __SSE2__
+        // 16 ASCII characters at a time, narrowed with saturating packs
+        while (end - text >= 16 && maxCount - done >= 16) {
+            const __m128i* pt = reinterpret_cast<const __m128i*>(text);
+            __m128i bytes;
+            __m128i all;
+
+            if (sizeof(Char) == 2) {
+                __m128i a = _mm_loadu_si128(pt);
+                __m128i b = _mm_loadu_si128(pt + 1);
+
+                all = _mm_or_si128(a, b);
+                bytes = _mm_packus_epi16(a, b);
+            } else {
+                __m128i a = _mm_loadu_si128(pt);
+                __m128i b = _mm_loadu_si128(pt + 1);
+                __m128i c = _mm_loadu_si128(pt + 2);
+                __m128i d = _mm_loadu_si128(pt + 3);
+
+                all = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+                bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            }
+
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(all, nonAscii), zero)) != 0xffff) {
+                break;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), bytes);
+            dest += 16;
+            text += 16;
+            done += 16;
+        }
+#endif
+
+        if (text == end || done == maxCount) {
+            break;
+        }
+
+        uint32_t c = static_cast<uint32_t>(*(text++));
+
+        if (sizeof(Char) == 2) {
+            c &= 0xffff;
+
+            if (c >= 0xd800 && c < 0xdc00 && text != end) {
+                uint32_t low = static_cast<uint32_t>(*text) & 0xffff;
+
+                if (low >= 0xdc00 && low < 0xe000) {
+                    c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                    text++;
+                }
+            }
+        }
+
+        if ((c >= 0xd800 && c < 0xe000) || c > 0x10ffff) {
+            c = 0xfffd;
+        }
+
+        if (c < 0x80) {
+            *(dest++) = char(c);
+        } else if (c < 0x800) {
+            dest[0] = char(0xc0 | (c >> 6));
+            dest[1] = char(0x80 | (c & 0x3f));
+            dest += 2;
+        } else if (c < 0x10000) {
+            dest[0] = char(0xe0 | (c >> 12));
+            dest[1] = char(0x80 | ((c >> 6) & 0x3f));
+            dest[2] = char(0x80 | (c & 0x3f));
+            dest += 3;
+        } else {
+            dest[0] = char(0xf0 | (c >> 18));
+            dest[1] = char(0x80 | ((c >> 12) & 0x3f));
+            dest[2] = char(0x80 | ((c >> 6) & 0x3f));
+            dest[3] = char(0x80 | (c & 0x3f));
+            dest += 4;
+        }
+
+        done++;
+    }
+
+    count = done;
+    return dest;
+}
+
+// Output a UTF-16 or UTF-32 string as UTF-8.  With '%s', width and precision
+// count code points and the text is transcoded straight into the
+// destination.  '%S' and the '~' flag work on the transcoded text.
+template <typename Char>
+static void outputText(tsioImplementation::Format& format, const Char* text, size_t size)
+{
+    using namespace tsioImplementation;
+
+    auto& dest = format.dest;
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+    unsigned type = state.type;
+    int maxSize = state.precisionGiven() ? state.precision : std::numeric_limits<int>::max();
+    size_t unitSize = sizeof(Char) == 2 ? 3 : 4;
+
+    if (spec != 's' && spec != 'S') {
+        for (size_t i = 0; i < size; ++i) {
+            printfDetail(format,
+                         static_cast<long long>(text[i]),
+                         static_cast<unsigned long long>(text[i]),
+                         std::is_signed<Char>::value);
+        }
+
+        return;
+    }
+
+    if (spec == 'S' || (type & columns)) {
+        Buffer tmp;
+        size_t count;
+
+        tmp.widen(size * unitSize);
+        tmp.shrink(tmp.data() + tmp.size() - transcode(tmp.data(), text, size, size, count));
+
+        if (spec == 'S') {
+            outputNice(format, tmp.data(), tmp.size(), maxSize);
+        } else {
+            outputString(format, tmp.data(), int(tmp.size()), maxSize);
+        }
+
+        return;
+    }
+
+    // a code point takes at most 2 units
+    if (size / 2 > size_t(maxSize)) {
+        size = 2 * size_t(maxSize);
+    }
+
+    size_t start = dest.size();
+    size_t count;
+
+    dest.widen(size * unitSize);
+
+    char* end = transcode(dest.data() + start, text, size, maxSize, count);
+    size_t length = end - (dest.data() + start);
+
+    dest.shrink(dest.data() + dest.size() - end);
+
+    if (state.width > count) {
+        size_t fillSize = state.width - count;
+        size_t offset = (type & leftJustify) ? 0 : (type & centerJustify) ? fillSize / 2 : fillSize;
+        char fillCharacter = (type & alfafill) ? state.fillCharacter : ' ';
+
+        dest.widen(fillSize);
+
+        char* pt = dest.data() + start;
+
+        memmove(pt + offset, pt, length);
+        fill(pt, fillCharacter, unsigned(offset));
+        fill(pt + offset + length, fillCharacter, unsigned(fillSize - offset));
+    }
+}
+
+template <typename Char>
+static void outputTextPointer(tsioImplementation::Format& format, const Char* value)
+{
+    auto& state = format.nextNode->state;
+
+    if (state.formatSpecifier == 'p') {
+        outputPointer(format, uintptr_t(value));
+        return;
+    }
+
+    // with '%s', a precision also limits the search for the terminating null
+    size_t limit = std::numeric_limits<size_t>::max();
+
+    if (state.formatSpecifier == 's' && state.precisionGiven() && (state.type & tsioImplementation::columns) == 0) {
+        limit = 2 * size_t(state.precision);
+    }
+
+    size_t size = 0;
+
+    while (size < limit && value[size] != 0) {
+        size++;
+    }
+
+    outputText(format, value, size);
+}
+
+void tsioImplementation::printfString(Format& format, const char16_t* value, size_t size)
+{
+    outputText(format, value, size);
+}
+
+void tsioImplementation::printfString(Format& format, const char32_t* value, size_t size)
+{
+    outputText(format, value, size);
+}
+
+void tsioImplementation::printfString(Format& format, const wchar_t* value, size_t size)
+{
+    outputText(format, value, size);
+}
+
+void tsioImplementation::printfDetail(Format& format, const char16_t* value)
+{
+    outputTextPointer(format, value);
+}
+
+void tsioImplementation::printfDetail(Format& format, const char32_t* value)
+{
+    outputTextPointer(format, value);
+}
+
+void tsioImplementation::printfDetail(Format& format, const wchar_t* value)
+{
+    outputTextPointer(format, value);
+}
+
+// Write the 'count' lowest decimal digits of 'number', with leading zeros.
+static char* writeDigits(char* pt, unsigned long long number, unsigned count)
+{
+    pt += count;
+
+    for (char* p = pt; p != pt - count; number /= 10) {
+        *(--p) = char('0' + number % 10);
+    }
+
+    return pt;
+}
+
+// Shortest round-trip conversion of doubles (Schubfach, R. Giulietti).
+//
+// Entry k - minPowerIndex holds g = floor(10^-k / 2^r) + 1, where r is chosen
+// such that 2^125 <= g < 2^126, split in two 63 bit halves.
+static const int minPowerIndex = -324;
+
+static const unsigned long long scaledPowersOf10[617][2] = {
+    { 0x4f0cedc95a718dd4ull, 0x5b01e8b09aa0d1b5ull }, { 0x7e7b160ef71c1621ull, 0x119ca780f767b5eeull },
+    { 0x652f44d8c5b011b4ull, 0x0e16ec672c52f7f2ull }, { 0x50f29d7a37c00e29ull, 0x581256b8f0425ff5ull },
+    { 0x40c21794f96671baull, 0x79a84560c0351991ull }, { 0x679cf287f570b5f7ull, 0x75da089acd21c281ull },
+    { 0x52e3f5399126f7f9ull, 0x44ae6d48a41b0201ull }, { 0x424ff76140ebf994ull, 0x36f1f106e9af34cdull },
+    { 0x6a198bcece465c20ull, 0x57e981a4a918547bull }, { 0x54e13ca571d1e34dull, 0x2cbace1d541376c9ull },
+    { 0x43e763b78e4182a4ull, 0x23c8a4e44342c56eull }, { 0x6ca56c58e39c043aull, 0x060dd4a06b9e08b0ull },
+    { 0x56eabd13e9499cfbull, 0x1e7176e6bc7e6d59ull }, { 0x458897432107b0c8ull, 0x7ec12bebc9febde1ull },
+    { 0x6f40f20501a5e7a7ull, 0x7e01dfdfa9979635ull }, { 0x5900c19d9aeb1fb9ull, 0x4b34b319547944f7ull },
+    { 0x4733ce17af227fc7ull, 0x55c3c27aa9fa9d93ull }, { 0x71ec7cf2b1d0cc72ull, 0x560603f7765dc8eaull },
+    { 0x5b2397288e40a38eull, 0x7804cff92b7e3a55ull }, { 0x48e945ba0b66e93full, 0x13370cc755fe9511ull },
+    { 0x74a86f90123e41feull, 0x51f1ae0bbcca881bull }, { 0x5d538c7341cb67feull, 0x74c1580963d539afull },
+    { 0x4aa93d29016f8665ull, 0x43cde0078310faf3ull }, { 0x77752ea8024c0a3cull, 0x0616333f381b2b1eull },
+    { 0x5f90f22001d66e96ull, 0x3811c298f9af55b1ull }, { 0x4c73f4e667debedeull, 0x600e35472e25de28ull },
+    { 0x7a532170a6313164ull, 0x3349eed849d6303full }, { 0x61dc1ac084f42783ull, 0x42a18be03b11c033ull },
+    { 0x4e49af006a5cec69ull, 0x1bb46fe695a7ccf5ull }, { 0x7d42b19a43c7e0a8ull, 0x2c53e63dbc3fae55ull },
+    { 0x64355ae1cfd31a20ull, 0x237651cafcffbeaaull }, { 0x502aaf1b0ca8e1b3ull, 0x35f8416f30cc9888ull },
+    { 0x402225af3d53e7c2ull, 0x5e603458f3d6e06dull }, { 0x669d0918621fd937ull, 0x4a3386f4b957cd7bull },
+    { 0x52173a79e8197a92ull, 0x6e8f9f2a2ddfd796ull }, { 0x41ac2ec7ece12edbull, 0x720c7f54f17fdfabull },
+    { 0x69137e0cae3517c6ull, 0x1ce0cbbb1bffcc45ull }, { 0x540f980a24f74638ull, 0x171a3c95afffd69eull },
+    { 0x433facd4ea5f6b60ull, 0x127b63aaf3331218ull }, { 0x6b991487dd657899ull, 0x6a5f05de51eb5026ull },
+    { 0x5614106cb11dfa14ull, 0x5518d17ea7ef7352ull }, { 0x44dcd9f08db194ddull, 0x2a7a41321ff2c2a8ull },
+    { 0x6e2e2980e2b5bafbull, 0x5d906850331e043full }, { 0x5824ee00b55e2f2full, 0x647386a68f4b3699ull },
+    { 0x4683f19a2ab1bf59ull, 0x36c2d21ed908f87bull }, { 0x70d31c29dde93228ull, 0x579e1cfe280e5a5dull },
+    { 0x5a427cee4b20f4edull, 0x2c7e7d98200b7b7eull }, { 0x483530bea280c3f1ull, 0x09fecae019a2c932ull },
+    { 0x73884dfdd0ce064eull, 0x43314499c29e0eb6ull }, { 0x5c6d0b3173d8050bull, 0x4f5a9d47cee4d891ull },
+    { 0x49f0d5c129799da2ull, 0x72aee4397250ad41ull }, { 0x764e22cea8c295d1ull, 0x377e39f583b44868ull },
+    { 0x5ea4e8a553cede41ull, 0x12cb61913629d387ull }, { 0x4bb72084430be500ull, 0x756f8140f8217605ull },
+    { 0x792500d39e796e67ull, 0x6f18cece59cf233cull }, { 0x60ea670fb1fabeb9ull, 0x3f470bd847d8e8fdull },
+    { 0x4d885272f4c89894ull, 0x329f3cad064720caull }, { 0x7c0d50b7ee0dc0edull, 0x37652de1a3a50143ull },
+    { 0x633dda2cbe716724ull, 0x2c50f1814fb73436ull }, { 0x4f64ae8a31f45283ull, 0x3d0d8e010c92902bull },
+    { 0x7f077da9e986ea6bull, 0x7b48e334e0ea8045ull }, { 0x659f97bb2138bb89ull, 0x49071c2a4d88669dull },
+    { 0x514c796280fa2fa1ull, 0x20d27ceea46d1ee4ull }, { 0x4109fab533fb594dull, 0x670eca58838a7f1dull },
+    { 0x680ff788532bc216ull, 0x0b4add5a6c10cb62ull }, { 0x533ff939dc2301abull, 0x22a24aaebcda3c4eull },
+    { 0x4299942e49b59aefull, 0x354ea22563e1c9d8ull }, { 0x6a8f537d42bc2b18ull, 0x554a9d089fcfa95aull },
+    { 0x553f75fdcefcef46ull, 0x776ee406e63fbaaeull }, { 0x4432c4cb0bfd8c38ull, 0x5f8be99f1e996225ull },
+    { 0x6d1e07ab466279f4ull, 0x327975cb64289d08ull }, { 0x574b3955d1e86190ull, 0x28612b091ced4a6dull },
+    { 0x45d5c777db204e0dull, 0x06b4226db0bdd524ull }, { 0x6fbc72595e9a167bull, 0x24536a491ac95506ull },
+    { 0x59638eade54811fcull, 0x1d0f883a7bd44405ull }, { 0x4782d88b1dd34196ull, 0x4a72d361fca9d004ull },
+    { 0x726af411c952028aull, 0x43eaebcffaa94cd3ull }, { 0x5b88c3416ddb353bull, 0x4fef230cc88770a9ull },
+    { 0x493a35cdf17c2a96ull, 0x0cbf4f3d6d3926eeull }, { 0x7529efafe8c6aa89ull, 0x61321862485b717cull },
+    { 0x5dbb262653d22207ull, 0x675b46b506af8dfdull }, { 0x4afc1e850fdb4e6cull, 0x52af6bc405593e64ull },
+    { 0x77f9ca6e7fc54a47ull, 0x377f12d33bc1fd6dull }, { 0x5ffb085866376e9full, 0x45ff42429634cabdull },
+    { 0x4cc8d379eb5f8bb2ull, 0x6b329b68782a3bcbull }, { 0x7adaebf64565ac51ull, 0x2b842bda59dd2c77ull },
+    { 0x6248bcc5045156a7ull, 0x3c69bcaeae4a89f9ull }, { 0x4ea0970403744552ull, 0x6387ca25583ba194ull },
+    { 0x7dcdbe6cd253a21eull, 0x05a6103bc05f68edull }, { 0x64a498570ea94e7eull, 0x37b80cfc99e5ed8aull },
+    { 0x5083ad1272210b98ull, 0x2c933d96e184be08ull }, { 0x40695741f4e73c79ull, 0x7075cadf1ad09807ull },
+    { 0x670ef2032171fa5cull, 0x4d8944982ae759a4ull }, { 0x52725b35b45b2eb0ull, 0x3e076a135585e150ull },
+    { 0x41f515c49048f226ull, 0x64d2bb42aad1810dull }, { 0x698822d41a0e503eull, 0x07b7920444826815ull },
+    { 0x546ce8a9ae71d9cbull, 0x1fc60e69d0685344ull }, { 0x438a53baf1f4ae3cull, 0x196b3ebb0d20429dull },
+    { 0x6c1085f7e9877d2dull, 0x0f11fdf815006a94ull }, { 0x56739e5fee05fdbdull, 0x58db319344005543ull },
+    { 0x45294b7ff19e6497ull, 0x60af5adc3666aa9cull }, { 0x6ea878ccb5ca3a8cull, 0x344bc4938a3dddc7ull },
+    { 0x5886c70a2b082ed6ull, 0x5d096a0fa1cb17d2ull }, { 0x46d238d4ef39bf12ull, 0x173abb3fb4a27975ull },
+    { 0x71505aee4b8f981dull, 0x0b912b992103f588ull }, { 0x5aa6af25093face4ull, 0x0940efadb4032ad3ull },
+    { 0x488558ea6dcc8a50ull, 0x07672624900288a9ull }, { 0x74088e43e2e0dd4cull, 0x723ea36db337410eull },
+    { 0x5cd3a5031be71770ull, 0x5b654f8af5c5cda5ull }, { 0x4a42ea68e31f45f3ull, 0x62b772d5916b0aebull },
+    { 0x76d1770e38320986ull, 0x0458b7bc1bde77ddull }, { 0x5f0df8d82cf4d46bull, 0x1d13c630164b9318ull },
+    { 0x4c0b2d79bd90a9efull, 0x30dc9e8cdea2dc13ull }, { 0x79ab7bf5fc1aa97full, 0x0160fdae31049351ull },
+    { 0x6155fcc4c9aeedffull, 0x1ab3fe24f403a90eull }, { 0x4dde63d0a158be65ull, 0x6229981d9002eda5ull },
+    { 0x7c97061a9bc130a2ull, 0x69dc2695b337e2a1ull }, { 0x63ac04e2163426e8ull, 0x54b01ede28f9821bull },
+    { 0x4fbcd0b4de901f20ull, 0x43c018b1ba6134e2ull }, { 0x7f9481216419cb67ull, 0x1f99c11c5d68549dull },
+    { 0x6610674de9ae3c52ull, 0x4c7b00e37ded107eull }, { 0x51a6b90b21583042ull, 0x09fc00b5fe574065ull },
+    { 0x41522da2811359ceull, 0x3b3000919845cd1dull }, { 0x68837c3734ebc2e3ull, 0x784ccdb5c06fae95ull },
+    { 0x539c635f5d8968b6ull, 0x2d0a3e2b00595877ull }, { 0x42e382b2b13aba2bull, 0x3da1cb5599e11393ull },
+    { 0x6b059deab52ac378ull, 0x629c7888f634ec1eull }, { 0x559e17eef755692dull, 0x3549fa072b5d89b1ull },
+    { 0x447e798bf91120f1ull, 0x1107fb38ef7e07c1ull }, { 0x6d9728dff4e834b5ull, 0x01a65ec17f300c68ull },
+    { 0x57ac20b32a535d5dull, 0x4e1eb23465c009edull }, { 0x46234d5c21dc4ab1ull, 0x24e55b5d1e333b24ull },
+    { 0x70387bc69c93aab5ull, 0x216ef894fd1ec506ull }, { 0x59c6c96bb076222aull, 0x4df2607730e56a6cull },
+    { 0x47d23abc8d2b4e88ull, 0x3e5b805f5a5121f0ull }, { 0x72e9f79415121740ull, 0x63c59a322a1b697full },
+    { 0x5bee5fa9aa74df67ull, 0x03047b5b54e2baccull }, { 0x498b7fbaeec3e5ecull, 0x0269fc4910b5623dull },
+    { 0x75abff917e063cacull, 0x6a432d41b45569fbull }, { 0x5e2332dacb38308aull, 0x21cf5767c37787fcull },
+    { 0x4b4f5be23c2cf3a1ull, 0x67d912b9692c6ccaull }, { 0x787ef969f9e185cfull, 0x595b5128a8471476ull },
+    { 0x60659454c7e79e3full, 0x6115da86ed05a9f8ull }, { 0x4d1e1043d31fb1ccull, 0x4dab1538bd9e2193ull },
+    { 0x7b634d3951cc4fadull, 0x62ab552795c9cf52ull }, { 0x62b5d7610e3d0c8bull, 0x0222aa86116e3f75ull },
+    { 0x4ef7df80d830d6d5ull, 0x4e822204dabe992aull }, { 0x7e59659af38157bcull, 0x17369cd49130f510ull },
+    { 0x65145148c2cddfc9ull, 0x5f5ee3dd40f3f740ull }, { 0x50dd0dd3cf0b196eull, 0x1918b64a9a5cc5cdull },
+    { 0x40b0d7dca5a27abeull, 0x4746f83baeb09e3eull }, { 0x678159610903f797ull, 0x253e59f91780fd2full },
+    { 0x52cde11a6d9cc612ull, 0x50feae60df9a6426ull }, { 0x423e4daebe1704dbull, 0x5a65584d7faeb685ull },
+    { 0x69fd4917968b3af9ull, 0x10a226e265e4573bull }, { 0x54caa0dfaba29594ull, 0x0d4e8581eb1d1295ull },
+    { 0x43d54d7fbc821143ull, 0x243ed134bc174211ull }, { 0x6c887bff94034ed2ull, 0x06cae85460253682ull },
+    { 0x56d396661002a574ull, 0x6bd586a9e6842b9bull }, { 0x457611eb40021df7ull, 0x09779eee52035616ull },
+    { 0x6f234fdeccd02ff1ull, 0x5bf297e3b66bbcefull }, { 0x58e90cb23d73598eull, 0x165bacb62b8963f3ull },
+    { 0x4720d6f4fdf5e13eull, 0x451623c4efa11cc2ull }, { 0x71ce24bb2fefcecaull, 0x3b569fa17f682e03ull },
+    { 0x5b0b5095bff30bd5ull, 0x15dee61acc535803ull }, { 0x48d5da11665c0977ull, 0x2b18b8157042accfull },
+    { 0x74895ce8a3c6758bull, 0x5e8df355806aae18ull }, { 0x5d3ab0ba1c9ec46full, 0x653e5c4466bbbe7aull },
+    { 0x4a955a2e7d4bd059ull, 0x3765169d1efc9861ull }, { 0x77555d172edfb3c2ull, 0x256e8a94fe60f3cfull },
+    { 0x5f777dac257fc301ull, 0x6abed543feb3f63full }, { 0x4c5f97bceacc9c01ull, 0x3bcbddcffef65e99ull },
+    { 0x7a328c6177adc668ull, 0x5fac961997f0975bull }, { 0x61c209e792f16b86ull, 0x7fbd44e1465a12afull },
+    { 0x4e34d4b9425abc6bull, 0x7fca9d810514dbbfull }, { 0x7d21545b9d5dfa46ull, 0x32ddc8ce6e87c5ffull },
+    { 0x641aa9e2e44b2e9eull, 0x5be4a0a525396b32ull }, { 0x501554b5836f587eull, 0x7cb6e6ea842def5cull },
+    { 0x4011109135f2ad32ull, 0x30925255368b25e3ull }, { 0x6681b41b89844850ull, 0x4db6ea21f0dea304ull },
+    { 0x52015ce2d469d373ull, 0x57c5881b2718826aull }, { 0x419ab0b576bb0f8full, 0x5fd139af527a01efull },
+    { 0x68f781225791b27full, 0x4c81f5e550c3364aull }, { 0x53f9341b79415b99ull, 0x239b2b1dda35c508ull },
+    { 0x432dc3492dcde2e1ull, 0x02e288e4ae916a6dull }, { 0x6b7c6ba849496b01ull, 0x516a74a1174f10aeull },
+    { 0x55fd22ed076def34ull, 0x4121f6e745d8da25ull }, { 0x44ca82573924bf5dull, 0x1a8192529e4714ebull },
+    { 0x6e10d08b8ea1322eull, 0x5d9c1d50fd3e87ddull }, { 0x580d73a2d880f4f2ull, 0x17b01773fdcb9fe4ull },
+    { 0x4671294f139a5d8eull, 0x4626792997d61984ull }, { 0x70b50ee4ec2a2f4aull, 0x3d0a5b75bfbcf59full },
+    { 0x5a2a7250bcee8c3bull, 0x4a6eaf916630c47full }, { 0x4821f50d63f209c9ull, 0x21f2260deb5a36ccull },
+    { 0x736988156cb6760eull, 0x69837016455d247aull }, { 0x5c546cddf091f80bull, 0x6e02c011d1175062ull },
+    { 0x49dd23e4c074c66full, 0x719bccdb0dac404eull }, { 0x762e9fd467213d7full, 0x68f947c4e2ad33b0ull },
+    { 0x5e8bb3105280fdffull, 0x6d94396a4ef0f627ull }, { 0x4ba2f5a6a8673199ull, 0x3e102deea58d91b9ull },
+    { 0x7904bc3dda3eb5c2ull, 0x3019e3176f48e927ull }, { 0x60d09697e1cbc49bull, 0x4014b5ac590720ecull },
+    { 0x4d73abacb4a303afull, 0x4cdd5e237a6c1a57ull }, { 0x7bec45e12104d2b2ull, 0x47c8969f2a46908aull },
+    { 0x63236b1a80d0a88eull, 0x6ca0787f5505406full }, { 0x4f4f88e200a6ed3full, 0x0a19f9ff773766bfull },
+    { 0x7ee5a7d0010b1531ull, 0x5cf65ccbf1f23dfeull }, { 0x6584864000d5aa8eull, 0x172b7d6ff4c1cb32ull },
+    { 0x5136d1cccd77bba4ull, 0x78ef978cc3ce3c28ull }, { 0x40f8a7d70ac62fb7ull, 0x13f2dfa3cfd83020ull },
+    { 0x67f43fbe77a37f8bull, 0x398499061959e699ull }, { 0x5329cc985fb5ffa2ull, 0x6136e0d1ade18548ull },
+    { 0x4287d6e04c91994full, 0x00f8b3daf181376dull }, { 0x6a72f166e0e8f54bull, 0x1b27862b1c01f247ull },
+    { 0x5528c11f1a53f76full, 0x2f52d1bc1667f506ull }, { 0x44209a7f48432c59ull, 0x0c424163451ff738ull },
+    { 0x6d00f7320d3846f4ull, 0x7a039bd208332526ull }, { 0x5733f8f4d76038c3ull, 0x7b361641a028ea85ull },
+    { 0x45c32d90ac4cfa36ull, 0x2f5e78348020bb9eull }, { 0x6f9eaf4de07b29f0ull, 0x4bca59ed99cdf8fcull },
+    { 0x594bbf71806287f3ull, 0x563b7b247b0b2d96ull }, { 0x476fcc5acd1b9ff6ull, 0x11c92f50626f57acull },
+    { 0x724c7a2ae1c5ccbdull, 0x02db7ee703e55912ull }, { 0x5b7061bbe7d17097ull, 0x1be2cbec031de0dcull },
+    { 0x4926b496530df3acull, 0x164f09899c17e716ull }, { 0x750aba8a1e7cb913ull, 0x3d4b4275c68ca4f0ull },
+    { 0x5da22ed4e530940full, 0x4aa29b916ba3b726ull }, { 0x4ae825771dc07672ull, 0x6ee87c74561c9285ull },
+    { 0x77d9d58b62cd8a51ull, 0x3173fa53bcfa8408ull }, { 0x5fe177a2b5713b74ull, 0x278ffb7630c869a0ull },
+    { 0x4cb45fb55df42f90ull, 0x1fa662c4f3d387b3ull }, { 0x7aba32bbc986b280ull, 0x32a3d13b1fb8d91full },
+    { 0x622e8efca1388ecdull, 0x0ee9742f4c93e0e6ull }, { 0x4e8ba596e760723dull, 0x58bac3590a0fe71eull },
+    { 0x7dac3c24a5671d2full, 0x412ad228101971c9ull }, { 0x6489c9b6eab8e426ull, 0x00ef0e8673478e3bull },
+    { 0x506e3af8bbc71cebull, 0x1a58d86b8f6c71c9ull }, { 0x40582f2d6305b0bcull, 0x1513e0560c56c16eull },
+    { 0x66f37eaf04d5e793ull, 0x3b530089ad579be2ull }, { 0x525c6558d0ab1fa9ull, 0x15dc006e2446164full },
+    { 0x41e384470d55b2edull, 0x5e4999f1b69e783full }, { 0x696c06d81555eb15ull, 0x7d428fe92430c065ull },
+    { 0x54566be0111188deull, 0x31020cba835a3384ull }, { 0x4378564cda746d7eull, 0x5a680a2ecf7b5c69ull },
+    { 0x6bf3bd47c3ed7bfdull, 0x770cdd17b25efa42ull }, { 0x565c976c9cbdfccbull, 0x1270b0dfc1e59502ull },
+    { 0x4516df8a16fe63d5ull, 0x5b8d5a4c9b1e10ceull }, { 0x6e8aff4357fd6c89ull, 0x127bc3adc4fce7b0ull },
+    { 0x586f329c466456d4ull, 0x0ec96957d0ca52f3ull }, { 0x46bf5bb038504576ull, 0x3f07877973d50f29ull },
+    { 0x71322c4d26e6d58aull, 0x31a5a58f1fbb4b75ull }, { 0x5a8e89d75252446eull, 0x5aeaead8e62f6f91ull },
+    { 0x487207df750e9d25ull, 0x2f22557a51bf8c74ull }, { 0x73e9a63254e42ea2ull, 0x1836ef2a1c65ad86ull },
+    { 0x5cbaeb5b771cf21bull, 0x2cf8bf54e3848ad2ull }, { 0x4a2f22af927d8e7cull, 0x23fa32aa4f9d3bdbull },
+    { 0x76b1d118ea627d93ull, 0x5329eaaa18fb92f8ull }, { 0x5ef4a74721e86476ull, 0x0f54bbbb472fa8c6ull },
+    { 0x4bf6ec38e7ed1d2bull, 0x25dd62fc38f2ed6cull }, { 0x798b138e3fe1c845ull, 0x22fbd1938e517bdfull },
+    { 0x613c0fa4ffe7d36aull, 0x4f2fdadc71dac97full }, { 0x4dc9a61d998642bbull, 0x58f3157d27e23accull },
+    { 0x7c75d695c2706ac5ull, 0x74b82261d969f7adull }, { 0x63917877cec0556bull, 0x10934eb4adee5fbeull },
+    { 0x4fa793930bcd1122ull, 0x4075d8908b251965ull }, { 0x7f7285b812e1b504ull, 0x00bc8db411d4f56eull },
+    { 0x65f537c675815d9cull, 0x66fd3e29a7dd9125ull }, { 0x5190f96b91344ae3ull, 0x6bfdcb54864ada84ull },
+    { 0x4140c78940f6a24full, 0x6ffe3c439ea2486aull }, { 0x6867a5a867f103b2ull, 0x7ffd2d38fdd073dcull },
+    { 0x53861e2053273628ull, 0x6664242d97d9f64aull }, { 0x42d1b1b375b8f820ull, 0x51e9b68adfe191d5ull },
+    { 0x6ae91c5255f4c034ull, 0x1ca924116635b621ull }, { 0x558749db77f70029ull, 0x63ba83411e915e81ull },
+    { 0x446c3b15f9926687ull, 0x6962029a7edab201ull }, { 0x6d79f82328ea3da6ull, 0x0f03375d97c45001ull },
+    { 0x5794c6828721caebull, 0x259c2c4adfd04001ull }, { 0x46109eced2816f22ull, 0x5149bd08b30d0001ull },
+    { 0x701a97b150cf1837ull, 0x3542c80deb480001ull }, { 0x59aedfc10d7279c5ull, 0x7768a00b22a00001ull },
+    { 0x47bf19673df52e37ull, 0x79208008e8800001ull }, { 0x72cb5bd86321e38cull, 0x5b67334174000001ull },
+    { 0x5bd5e313828182d6ull, 0x7c528f6790000001ull }, { 0x4977e8dc68679bdfull, 0x16a872b940000001ull },
+    { 0x758ca7c70d7292feull, 0x5773eac200000001ull }, { 0x5e0a1fd271287598ull, 0x45f6556800000001ull },
+    { 0x4b3b4ca85a86c47aull, 0x04c5112000000001ull }, { 0x785ee10d5da46d90ull, 0x07a1b50000000001ull },
+    { 0x604be73de4838ad9ull, 0x52e7c40000000001ull }, { 0x4d0985cb1d3608aeull, 0x0f1fd00000000001ull },
+    { 0x7b426fab61f00de3ull, 0x31cc800000000001ull }, { 0x629b8c891b267182ull, 0x5b0a000000000001ull },
+    { 0x4ee2d6d415b85aceull, 0x7c08000000000001ull }, { 0x7e37be2022c0914bull, 0x1340000000000001ull },
+    { 0x64f964e68233a76full, 0x2900000000000001ull }, { 0x50c783eb9b5c85f2ull, 0x5400000000000001ull },
+    { 0x409f9cbc7c4a04c2ull, 0x1000000000000001ull }, { 0x6765c793fa10079dull, 0x0000000000000001ull },
+    { 0x52b7d2dcc80cd2e4ull, 0x0000000000000001ull }, { 0x422ca8b0a00a4250ull, 0x0000000000000001ull },
+    { 0x69e10de76676d080ull, 0x0000000000000001ull }, { 0x54b40b1f852bda00ull, 0x0000000000000001ull },
+    { 0x43c33c1937564800ull, 0x0000000000000001ull }, { 0x6c6b935b8bbd4000ull, 0x0000000000000001ull },
+    { 0x56bc75e2d6310000ull, 0x0000000000000001ull }, { 0x4563918244f40000ull, 0x0000000000000001ull },
+    { 0x6f05b59d3b200000ull, 0x0000000000000001ull }, { 0x58d15e1762800000ull, 0x0000000000000001ull },
+    { 0x470de4df82000000ull, 0x0000000000000001ull }, { 0x71afd498d0000000ull, 0x0000000000000001ull },
+    { 0x5af3107a40000000ull, 0x0000000000000001ull }, { 0x48c2739500000000ull, 0x0000000000000001ull },
+    { 0x746a528800000000ull, 0x0000000000000001ull }, { 0x5d21dba000000000ull, 0x0000000000000001ull },
+    { 0x4a817c8000000000ull, 0x0000000000000001ull }, { 0x7735940000000000ull, 0x0000000000000001ull },
+    { 0x5f5e100000000000ull, 0x0000000000000001ull }, { 0x4c4b400000000000ull, 0x0000000000000001ull },
+    { 0x7a12000000000000ull, 0x0000000000000001ull }, { 0x61a8000000000000ull, 0x0000000000000001ull },
+    { 0x4e20000000000000ull, 0x0000000000000001ull }, { 0x7d00000000000000ull, 0x0000000000000001ull },
+    { 0x6400000000000000ull, 0x0000000000000001ull }, { 0x5000000000000000ull, 0x0000000000000001ull },
+    { 0x4000000000000000ull, 0x0000000000000001ull }, { 0x6666666666666666ull, 0x3333333333333334ull },
+    { 0x51eb851eb851eb85ull, 0x0f5c28f5c28f5c29ull }, { 0x4189374bc6a7ef9dull, 0x5916872b020c49bbull },
+    { 0x68db8bac710cb295ull, 0x74f0d844d013a92bull }, { 0x53e2d6238da3c211ull, 0x43f3e0370cdc8755ull },
+    { 0x431bde82d7b634daull, 0x698fe69270b06c44ull }, { 0x6b5fca6af2bd215eull, 0x0f4ca41d811a46d4ull },
+    { 0x55e63b88c230e77eull, 0x3f70834acdae9f10ull }, { 0x44b82fa09b5a52cbull, 0x4c5a02a23e254c0dull },
+    { 0x6df37f675ef6eadfull, 0x2d5cd10396a21347ull }, { 0x57f5ff85e592557full, 0x3de3da69454e75d3ull },
+    { 0x465e6604b7a84465ull, 0x7e4fe1edd10b9175ull }, { 0x709709a125da0709ull, 0x4a19697c81ac1befull },
+    { 0x5a126e1a84ae6c07ull, 0x54e1213067bce326ull }, { 0x480ebe7b9d58566cull, 0x43e74dc052fd8285ull },
+    { 0x734aca5f6226f0adull, 0x530baf9a1e626a6dull }, { 0x5c3bd5191b525a24ull, 0x426fbfae7eb521f1ull },
+    { 0x49c97747490eae83ull, 0x4ebfcc8b9890e7f4ull }, { 0x760f253edb4ab0d2ull, 0x4acc7a78f41b0cbaull },
+    { 0x5e72843249088d75ull, 0x223d2ec729af3d62ull }, { 0x4b8ed0283a6d3df7ull, 0x34fdbf05baf29781ull },
+    { 0x78e480405d7b9658ull, 0x54c931a2c4b758cfull }, { 0x60b6cd004ac94513ull, 0x5d6dc14f03c5e0a5ull },
+    { 0x4d5f0a66a23a9da9ull, 0x31249aa59c9e4d51ull }, { 0x7bcb43d769f762a8ull, 0x4ea0f76f60fd4882ull },
+    { 0x63090312bb2c4eedull, 0x254d92bf80caa068ull }, { 0x4f3a68dbc8f03f24ull, 0x1dd7a89933d54d20ull },
+    { 0x7ec3daf941806506ull, 0x62f2a75b86221500ull }, { 0x65697bfa9acd1d9full, 0x025bb91604e810cdull },
+    { 0x51212ffbaf0a7e18ull, 0x684960de6a5340a4ull }, { 0x40e7599625a1fe7aull, 0x203ab3e521dc33b6ull },
+    { 0x67d88f56a29cca5dull, 0x19f7863b696052bdull }, { 0x5313a5dee87d6eb0ull, 0x7b2c6b62bab37564ull },
+    { 0x42761e4bed31255aull, 0x2f56bc4efbc2c450ull }, { 0x6a5696dfe1e83bc3ull, 0x655793b192d13a1aull },
+    { 0x5512124cb4b9c969ull, 0x377942f475742e7bull }, { 0x440e750a2a2e3abaull, 0x5f9435905df68b96ull },
+    { 0x6ce3ee76a9e3912aull, 0x65b9ef4d63241289ull }, { 0x571cbec554b60dbbull, 0x6afb25d782834207ull },
+    { 0x45b0989ddd5e7163ull, 0x08c8eb12cecf6806ull }, { 0x6f80f42fc8971bd1ull, 0x5adb11b7b14bd9a3ull },
+    { 0x5933f68ca078e30eull, 0x157c0e2c8dd647b5ull }, { 0x475cc53d4d2d8271ull, 0x5dfcd823a4ab6c91ull },
+    { 0x722e086215159d82ull, 0x632e269f6ddf141bull }, { 0x5b5806b4ddaae468ull, 0x4f581ee5f17f4349ull },
+    { 0x49133890b1558386ull, 0x72ace584c1329c3bull }, { 0x74eb8db44eef38d7ull, 0x6aae3c079b842d2aull },
+    { 0x5d893e29d8bf60acull, 0x5558300616035755ull }, { 0x4ad431bb13cc4d56ull, 0x7779c004de6912abull },
+    { 0x77b9e92b52e07bbeull, 0x258f99a163db5111ull }, { 0x5fc7edbc424d2fcbull, 0x37a614811caf740dull },
+    { 0x4c9ff163683dbfd5ull, 0x7951aa00e3bf900bull }, { 0x7a998238a6c932efull, 0x754f7667d2cc19abull },
+    { 0x6214682d523a8f26ull, 0x2aa5f8530f09ae22ull }, { 0x4e76b9bddb620c1eull, 0x55519375a5a1581bull },
+    { 0x7d8ac2c95f034697ull, 0x3bb5b8bc3c3559c5ull }, { 0x646f023ab2690545ull, 0x7c9160969691149eull },
+    { 0x5058ce955b87376bull, 0x16dab3ababa743b2ull }, { 0x40470baaaf9f5f88ull, 0x78aef622efb902f5ull },
+    { 0x66d812aab29898dbull, 0x0de4bd04b2c19e54ull }, { 0x524675555bad4715ull, 0x57ea30d08f014b76ull },
+    { 0x41d1f7777c8a9f44ull, 0x4654f3da0c01092cull }, { 0x694ff258c7443207ull, 0x23bb1fc346680eacull },
+    { 0x543ff513d29cf4d2ull, 0x4fc8e635d1ecd88aull }, { 0x43665da9754a5d75ull, 0x263a51c4a7f0ad3bull },
+    { 0x6bd6fc425543c8bbull, 0x56c3b607731aaec4ull }, { 0x5645969b77696d62ull, 0x789c919f8f488bd0ull },
+    { 0x4504787c5f878ab5ull, 0x46e3a7b2d906d640ull }, { 0x6e6d8d93cc0c1122ull, 0x3e390c515b3e239aull },
+    { 0x5857a4763cd6741bull, 0x4b60d6a77c31b615ull }, { 0x46ac8391ca4529afull, 0x55e7121f968e2b44ull },
+    { 0x711405b6106ea919ull, 0x0971b698f0e3786dull }, { 0x5a766af80d255414ull, 0x078e2bad8d82c6bdull },
+    { 0x485ebbf9a41ddcdcull, 0x6c71bc8ad79bd231ull }, { 0x73cac65c39c96161ull, 0x2d82c7448c2c8382ull },
+    { 0x5ca23849c7d44de7ull, 0x3e023903a356cf9bull }, { 0x4a1b603b06437185ull, 0x7e682d9c82abd949ull },
+    { 0x76923391a39f1c09ull, 0x4a4048fa6aac8edbull }, { 0x5edb5c7482e5b007ull, 0x55003a61eef07249ull },
+    { 0x4be2b05d35848cd2ull, 0x773361e7f259f507ull }, { 0x796ab3c855a0e151ull, 0x3eb89ca6508fee71ull },
+    { 0x6122296d114d810dull, 0x7efa16eb73a6585bull }, { 0x4db4edf0daa4673eull, 0x3261abef8fb846afull },
+    { 0x7c54afe7c43a3ecaull, 0x1d691318e5f3a44bull }, { 0x6376f31fd02e98a1ull, 0x64540f471e5c836full },
+    { 0x4f925c1973587a1bull, 0x0376729f4b7d35f3ull }, { 0x7f50935bebc0c35eull, 0x38bd84321261efebull },
+    { 0x65da0f7cbc9a35e5ull, 0x13cad0280eb4bfefull }, { 0x517b3f96fd482b1dull, 0x5ca240200bc3ccbfull },
+    { 0x412f66126439bc17ull, 0x63b50019a3030a33ull }, { 0x684bd683d38f9359ull, 0x1f88002904d1a9eaull },
+    { 0x536fdecfdc72dc47ull, 0x32d3335403daee55ull }, { 0x42bfe57316c249d2ull, 0x5bdc291003158b77ull },
+    { 0x6acca251be03a951ull, 0x12f9db4cd1bc1258ull }, { 0x557081dafe695440ull, 0x7594af70a7c9a847ull },
+    { 0x445a017bfebaa9cdull, 0x4476f2c0863aed06ull }, { 0x6d5ccf2ccac442e2ull, 0x3a57eacda3917b3cull },
+    { 0x577d728a3bd03581ull, 0x7b7988a482dac8fdull }, { 0x45fdf53b630cf79bull, 0x15fad3b6cf156d97ull },
+    { 0x6ffcbb923814bf5eull, 0x565e1f8ae4ef15beull }, { 0x5996fc74f9aa32b2ull, 0x11e4e608b725aaffull },
+    { 0x47abfd2a6154f55bull, 0x27ea51a0928488ccull }, { 0x72acc843ceee555eull, 0x7310829a84074146ull },
+    { 0x5bbd6d030bf1dde5ull, 0x42739baed005cdd2ull }, { 0x49645735a327e4b7ull, 0x4ec2e2f24004a4a8ull },
+    { 0x756d5855d1d96df2ull, 0x4ad16b1d333aa10cull }, { 0x5df11377db1457f5ull, 0x2241227dc2954da3ull },
+    { 0x4b2742c648dd132aull, 0x4e9a81fe35443e1cull }, { 0x783ed13d4161b844ull, 0x175d9cc9eed39694ull },
+    { 0x603240fdcde7c69cull, 0x7917b0a18bdc7876ull }, { 0x4cf500cb0b1fd217ull, 0x1412f3b46fe39392ull },
+    { 0x7b219ade7832e9beull, 0x535185ed7fd285b6ull }, { 0x628148b1f9c25498ull, 0x42a79e57997537c5ull },
+    { 0x4ecdd3c1949b76e0ull, 0x3552e512e12a9304ull }, { 0x7e161f9c20f8be33ull, 0x6eeb081e3510eb39ull },
+    { 0x64de7fb01a609829ull, 0x3f226ce4f740bc2eull }, { 0x50b1ffc0151a1354ull, 0x3281f0b72c33c9beull },
+    { 0x408e66334414dc43ull, 0x42018d5f568fd498ull }, { 0x674a3d1ed354939full, 0x1ccf48988a7fba8dull },
+    { 0x52a1ca7f0f76dc7full, 0x30a5d3ad3b99620bull }, { 0x421b0865a5f8b065ull, 0x73b7dc8a96144e6full },
+    { 0x69c4da3c3cc11a3cull, 0x52bfc7442353b0b1ull }, { 0x549d7b6363cdae96ull, 0x756639034f7626f4ull },
+    { 0x43b12f82b63e2545ull, 0x4451c735d92b525dull }, { 0x6c4eb26abd303ba2ull, 0x3a1c71efc1deea2eull },
+    { 0x56a55b889759c94eull, 0x61b05b2634b254f2ull }, { 0x45511606df7b0772ull, 0x1af37c1e908eaa5bull },
+    { 0x6ee8233e325e7250ull, 0x2b1f2cfdb41776f8ull }, { 0x58b9b5cb5b7ec1d9ull, 0x6f4c23fe29ac5f2dull },
+    { 0x46faf7d5e2cbce47ull, 0x72a34ffe87bd18f1ull }, { 0x71918c896adfb073ull, 0x04387ffda5fb5b1bull },
+    { 0x5adad6d4557fc05cull, 0x0360666484c915afull }, { 0x48af1243779966b0ull, 0x02b3851d3707448cull },
+    { 0x744b506bf28f0ab3ull, 0x1dec082ebe720746ull }, { 0x5d090d2328726ef5ull, 0x64bcd358985b3905ull },
+    { 0x4a6da41c205b8bf7ull, 0x6a30a913ad15c738ull }, { 0x7715d36033c5acbfull, 0x5d1aa81f7b560b8cull },
+    { 0x5f44a919c3048a32ull, 0x7daeece5fc44d609ull }, { 0x4c36edae359d3b5bull, 0x7e258a51969d7808ull },
+    { 0x79f17c49ef61f893ull, 0x16a276e8f0fbf33full }, { 0x618dfd07f2b4c6dcull, 0x121b9253f3fcc299ull },
+    { 0x4e0b30d328909f16ull, 0x41afa84329970214ull }, { 0x7cdeb4850db431bdull, 0x4f7f739ea8f19cedull },
+    { 0x63e55d373e29c164ull, 0x3f99294bba5ae3f1ull }, { 0x4feab0f8fe87cde9ull, 0x7fadbaa2fb7be98dull },
+    { 0x7fdde7f4ca72e30full, 0x7f7c5dd1925fdc15ull }, { 0x664b1ff7085be8d9ull, 0x4c637e4141e649abull },
+    { 0x51d5b32c06afed7aull, 0x704f983434b83aefull }, { 0x4177c2899ef32462ull, 0x26a6135cf6f9c8bfull },
+    { 0x68bf9da8fe51d3d0ull, 0x3dd685618b294132ull }, { 0x53cc7e20cb74a973ull, 0x4b12044e08edcdc2ull },
+    { 0x4309fe80a2c3bac2ull, 0x6f419d0b3a57d7ceull }, { 0x6b4330cdd1392ad1ull, 0x320294dec3bfbfb0ull },
+    { 0x55cf5a3e40fa88a7ull, 0x419baa4bcfcc995aull }, { 0x44a5e1cb672ed3b9ull, 0x1ae2eea30ca3ade1ull },
+    { 0x6dd636123eb152c1ull, 0x77d17dd1add2afcfull }, { 0x57de91a832277567ull, 0x797464a7be42263full },
+    { 0x464ba7b9c1b92ab9ull, 0x4790508631ce84ffull }, { 0x70790c5c6928445cull, 0x0c1a1a704fb0d4ccull },
+    { 0x59fa7049edb9d049ull, 0x567b4859d95a43d6ull }, { 0x47fb8d07f161736eull, 0x11fc39e17aae9cabull },
+    { 0x732c14d98235857dull, 0x032d2968c44a9445ull }, { 0x5c2343e134f79dfdull, 0x4f575453d03ba9d1ull },
+    { 0x49b5cfe75d92e4caull, 0x72ac4376402fbb0eull }, { 0x75efb30bc8eb07abull, 0x0446d256cd192b49ull },
+    { 0x5e595c096d88d2efull, 0x1d0575123dadbc3aull }, { 0x4b7ab0078ad3dbf2ull, 0x4a6ac40e97be302full },
+    { 0x78c44cd8de1fc650ull, 0x771139b0f2c9e6b1ull }, { 0x609d0a4718196b73ull, 0x78da948d8f07ebc1ull },
+    { 0x4d4a6e9f467abc5cull, 0x60aedd3e0c065634ull }, { 0x7baa4a9870c46094ull, 0x344afb9679a3bd20ull },
+    { 0x62eea2138d69e6ddull, 0x103bfc78614fca80ull }, { 0x4f254e760abb1f17ull, 0x26966393810ca200ull },
+    { 0x7ea21723445e9825ull, 0x2423d2859b476999ull }, { 0x654e78e9037ee01dull, 0x69b642047c392148ull },
+    { 0x510b93ed9c658017ull, 0x6e2b680396941aa0ull }, { 0x40d60ff149eaccdfull, 0x71bc53361210154dull },
+    { 0x67bce64edcaae166ull, 0x1c6085235019bbaeull }, { 0x52fd850be3bbe784ull, 0x7d1a041c40149625ull },
+    { 0x42646a6fe9631f9dull, 0x4a7b367d0010781dull }, { 0x6a3a43e642383295ull, 0x5d91f0c8001a59c8ull },
+    { 0x54fb698501c68edeull, 0x17a7f3d3334847d4ull }, { 0x43fc546a67d20be4ull, 0x79532975c2a03976ull },
+    { 0x6cc6ed770c83463bull, 0x0eeb75893766c256ull }, { 0x57058ac5a39c382full, 0x25892ad42c523512ull },
+    { 0x459e089e1c7cf9bfull, 0x37a0ef102374f742ull }, { 0x6f6340fcfa618f98ull, 0x59017e8038bb2536ull },
+    { 0x591c33fd951ad946ull, 0x7a67986693c8ea91ull }, { 0x4749c33144157a9full, 0x151fad1edca0bba8ull },
+    { 0x720f9eb539bbf765ull, 0x0832ae97c76792a5ull }, { 0x5b3fb22a94965f84ull, 0x068ef21305ec7551ull },
+    { 0x48ffc1bbaa11e603ull, 0x1ed8c1a8d189f774ull }, { 0x74cc692c434fd66bull, 0x4af4690e1c0ff253ull },
+    { 0x5d705423690cab89ull, 0x225d20d816732843ull }, { 0x4ac0434f873d5607ull, 0x35174d79ab8f5369ull },
+    { 0x779a054c0b955672ull, 0x21bee25c45b21f0eull }, { 0x5fae6aa33c77785bull, 0x3498b5169e2818d8ull },
+    { 0x4c8b888296c5f9e2ull, 0x5d46f7454b534713ull }, { 0x7a78da6a8ad65c9dull, 0x7ba4bed545520b52ull },
+    { 0x61fa48553bdeb07eull, 0x2fb6ff110441a2a8ull }, { 0x4e61d37763188d31ull, 0x72f8cc0d9d014eedull },
+    { 0x7d6952589e8daeb6ull, 0x1e5ae015c80217e1ull }, { 0x645441e07ed7bef8ull, 0x1848b344a001acb4ull },
+    { 0x504367e6cbdfcbf9ull, 0x603a2903b3348a2aull }, { 0x4035ecb8a3196ffbull, 0x002e873628f6d4eeull },
+    { 0x66bcadf43828b32bull, 0x19e40b89db2487e3ull }, { 0x52308b29c686f5bcull, 0x14b66fa17c1d3983ull },
+    { 0x41c06f549ed25e30ull, 0x1091f2e7967dc79cull }, { 0x6933e554315096b3ull, 0x341cb7d8f0c93f5full },
+    { 0x542984435aa6def5ull, 0x767d5fe0c0a0ff80ull }, { 0x435469cf7bb8b25eull, 0x2b977fe70080cc66ull },
+    { 0x6bba42e592c11d63ull, 0x5f58cca4cd9ae0a3ull }, { 0x562e9beadbcdb11cull, 0x4c470a1d7148b3b6ull },
+    { 0x44f216557ca48db0ull, 0x3d05a1b1276d5c92ull }, { 0x6e5023bbfaa0e2b3ull, 0x7b3c35e83f1560e9ull },
+    { 0x58401c96621a4ef6ull, 0x2f635e5365aab3edull }, { 0x4699b0784e7b725eull, 0x591c4b75eaeef658ull },
+    { 0x70f5e726e3f8b6fdull, 0x74fa125644b18a26ull }, { 0x5a5e5285832d5f31ull, 0x43fb41de9d5ad4ebull },
+    { 0x484b75379c244c27ull, 0x4ffc34b2177bdd89ull }, { 0x73abeebf603a1372ull, 0x4cc6bab68bf96274ull },
+    { 0x5c898bcc4cfb42c2ull, 0x0a38955ed6611b90ull }, { 0x4a07a309d72f689bull, 0x21c6dde5784dafa7ull },
+    { 0x76729e762518a75eull, 0x693e2fd58d49190bull }, { 0x5ec2185e8413b918ull, 0x5431bfde0aa0e0d5ull },
+    { 0x4bce79e536762dadull, 0x29c1664b3bb3e711ull }, { 0x794a5ca1f0bd15e2ull, 0x0f9bd6dec5eca4e8ull },
+    { 0x61084a1b26fdab1bull, 0x2616457f04bd50baull }, { 0x4da03b48ebfe227cull, 0x1e783798d09773c8ull },
+    { 0x7c33920e46636a60ull, 0x30c058f480f252d9ull }, { 0x635c74d8384f884dull, 0x0d66ad9067284247ull },
+    { 0x4f7d2a469372d370ull, 0x711ef14052869b6cull }, { 0x7f2eaa0a85848581ull, 0x34fe4ecd50d75f14ull },
+    { 0x65beee6ed136d134ull, 0x2a650bd773df7f43ull }, { 0x51658b8bda9240f6ull, 0x551da312c319329cull },
+    { 0x411e093caedb672bull, 0x5db14f4235adc217ull }, { 0x68300ec77e2bd845ull, 0x7c4ee536bc49368aull },
+    { 0x5359a56c64efe037ull, 0x7d0bea92303a9208ull }, { 0x42ae1df050bfe693ull, 0x173cbba8269541a0ull },
+    { 0x6ab02fe6e79970ebull, 0x3ec792a6a422029aull }, { 0x5559bfebec7ac0bcull, 0x3239421ee9b4cee1ull },
+    { 0x4447ccbcbd2f0096ull, 0x5b6101b25490a581ull }, { 0x6d3fadfac84b3424ull, 0x2bce691d541aa268ull },
+    { 0x576624c8a03c29b6ull, 0x563eba7ddce21b87ull }, { 0x45eb50a08030215eull, 0x78322ecb171b4939ull },
+    { 0x6fdee76733803564ull, 0x59e9e47824f87527ull }, { 0x597f1f85c2ccf783ull, 0x6187e9f9b72d2a86ull },
+    { 0x4798e6049bd72c69ull, 0x346cbb2e2c242205ull }, { 0x728e3cd42c8b7a42ull, 0x20adf849e039d007ull },
+    { 0x5ba4fd768a092e9bull, 0x33be603b19c7d99full }, { 0x4950cac53b3a8bafull, 0x42feb3627b0647b3ull },
+    { 0x754e113b91f745e5ull, 0x5197856a5e7072b8ull }, { 0x5dd80dc941929e51ull, 0x27ac6abb7ec05bc6ull },
+    { 0x4b133e3a9adbb1daull, 0x52f05562cbcd1638ull }, { 0x781ec9f75e2c4fc4ull, 0x1e4d556adfae89f3ull },
+    { 0x6018a192b1bd0c9cull, 0x7ea444557fbed4c3ull }, { 0x4ce0814227ca707dull, 0x4bb69d1132ff109cull },
+    { 0x7b00ced03faa4d95ull, 0x5f8a94e851981a93ull }, { 0x62670bd9cc883e11ull, 0x32d543ed0e134875ull },
+    { 0x4eb8d647d6d364daull, 0x5bddcff0d80f6d2bull }, { 0x7df48a0c8aebd491ull, 0x12fc7fe7c018aeabull },
+    { 0x64c3a1a3a25643a7ull, 0x28c9ffec99ad5889ull }, { 0x509c814fb511cfb9ull, 0x0707fff07af113a1ull },
+    { 0x407d343fc40e3fc7ull, 0x1f39998d2f2742e7ull }, { 0x672eb9ffa016cc71ull, 0x7ec28f484b7204a4ull },
+    { 0x528bc7ffb345705bull, 0x189ba5d36f8e6a1dull }, { 0x42096ccc8f6ac048ull, 0x7a161e42bfa521b1ull },
+    { 0x69a8ae1418aacd41ull, 0x435696d132a1cf81ull }, { 0x5486f1a9ad557101ull, 0x1c454574288172ceull },
+    { 0x439f27baf1112734ull, 0x169dd129ba0128a5ull }, { 0x6c31d92b1b4ea520ull, 0x242fb50f9001daa1ull },
+    { 0x568e4755af721db3ull, 0x368c90d940017bb4ull }, { 0x453e9f77bf8e7e29ull, 0x120a0d7a999ac95dull },
+    { 0x6eca98bf98e3fd0eull, 0x50101590f5c47561ull }, { 0x58a213cc7a4ffda5ull, 0x26734473f7d05de8ull },
+    { 0x46e80fd6c83ffe1dull, 0x6b8f69f65fd9e4b9ull }, { 0x71734c8ad9fffcfcull, 0x45b24323cc8fd45cull },
+    { 0x5ac2a3a247fffd96ull, 0x6af502830a0ca9e3ull }, { 0x489bb61b6ccccadfull, 0x08c402026e7087e9ull },
+    { 0x742c569247ae1164ull, 0x746cd003e3e73fdbull }, { 0x5cf04541d2f1a783ull, 0x76bd73364fec3315ull },
+    { 0x4a59d101758e1f9cull, 0x5efdf5c50cbcf5abull }, { 0x76f61b3588e365c7ull, 0x4b2fefa1adfb22abull },
+    { 0x5f2b48f7a0b5eb06ull, 0x08f3261af195b555ull }, { 0x4c22a0c61a2b226bull, 0x20c284e25ade2aabull },
+    { 0x79d1013cf6ab6a45ull, 0x1ad0d49d5e304444ull }, { 0x617400fd9222bb6aull, 0x48a7107de4f369d0ull },
+    { 0x4df6673141b562bbull, 0x53b8d9fe50c2bb0dull }, { 0x7cbd71e869223792ull, 0x52c15cca1ad12b48ull },
+    { 0x63cac186ba81c60eull, 0x75677d6e7bda8906ull }, { 0x4fd5679efb9b04d8ull, 0x5dec645863153a6cull },
+    { 0x7fbbd8fe5f5e6e27ull, 0x497a3a2704eec3dfull }
+};
+
+// The high 64 bits of the 128 bit product of 'a' and 'b'.
+inline TSIO_ALWAYS_INLINE unsigned long long multiplyHigh(unsigned long long a, unsigned long long b)
+{
+#ifdef __SIZEOF_INT128__
+    return static_cast<unsigned long long>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+    unsigned long long aLow = a & 0xffffffff;
+    unsigned long long aHigh = a >> 32;
+    unsigned long long bLow = b & 0xffffffff;
+    unsigned long long bHigh = b >> 32;
+    unsigned long long lowHigh = aLow * bHigh;
+    unsigned long long highLow = aHigh * bLow;
+    unsigned long long cross = ((aLow * bLow) >> 32) + (highLow & 0xffffffff) + lowHigh;
+
+    return aHigh * bHigh + (highLow >> 32) + (cross >> 32);
+#endif
+}
+
+// floor(q * log10(2)), floor(q * log10(3/4 * 2)) and floor(e * log2(10)) for
+// the exponent ranges of doubles.
+inline int floorLog10Pow2(int q)
+{
+    return int((q * 661971961083ll) >> 41);
+}
+
+inline int floorLog10ThreeQuartersPow2(int q)
+{
+    return int((q * 661971961083ll - 274743187321ll) >> 41);
+}
+
+inline int floorLog2Pow10(int e)
+{
+    return int((e * 913124641741ll) >> 38);
+}
+
+// The product of g and 'cp' divided by 2^127, rounded to odd.
+inline TSIO_ALWAYS_INLINE unsigned long long roundToOdd(const unsigned long long* g, unsigned long long cp)
+{
+    const unsigned long long mask63 = (1ull << 63) - 1;
+    unsigned long long x1 = multiplyHigh(g[1], cp);
+    unsigned long long y0 = g[0] * cp;
+    unsigned long long y1 = multiplyHigh(g[0], cp);
+    unsigned long long z = (y0 >> 1) + x1;
+
+    return (y1 + (z >> 63)) | (((z & mask63) + mask63) >> 63);
+}
+
+// Finds the shortest decimal 'digits' * 10^'exponent' that rounds to
+// c * 2^q, closest to it if there are several.
+static void schubfach(int q, unsigned long long c, unsigned long long& digits, int& exponent)
+{
+    const unsigned long long minSignificand = 1ull << 52;
+    unsigned long long out = c & 1;
+    unsigned long long cb = c << 2;
+    unsigned long long cbr = cb + 2;
+    unsigned long long cbl;
+    int k;
+
+    if (c != minSignificand || q == -1074) {
+        cbl = cb - 2;
+        k = floorLog10Pow2(q);
+    } else {
+        cbl = cb - 1;
+        k = floorLog10ThreeQuartersPow2(q);
+    }
+
+    int h = q + floorLog2Pow10(-k) + 2;
+    const unsigned long long* g = scaledPowersOf10[k - minPowerIndex];
+    unsigned long long vb = roundToOdd(g, cb << h);
+    unsigned long long vbl = roundToOdd(g, cbl << h);
+    unsigned long long vbr = roundToOdd(g, cbr << h);
+    unsigned long long s = vb >> 2;
+
+    if (s >= 10) {
+        // s / 10 * 10, and the next multiple of 10
+        unsigned long long sp10 = 10 * multiplyHigh(s, 1844674407370955168ull);
+        unsigned long long tp10 = sp10 + 10;
+        bool upin = vbl + out <= sp10 << 2;
+        bool wpin = (tp10 << 2) + out <= vbr;
+
+        if (upin != wpin) {
+            digits = upin ? sp10 : tp10;
+            exponent = k;
+            return;
+        }
+    }
+
+    unsigned long long t = s + 1;
+    bool uin = vbl + out <= s << 2;
+    bool win = (t << 2) + out <= vbr;
+
+    exponent = k;
+
+    if (uin != win) {
+        digits = uin ? s : t;
+    } else {
+        long long cmp = static_cast<long long>(vb - ((s + t) << 1));
+
+        digits = (cmp < 0 || (cmp == 0 && (s & 1) == 0)) ? s : t;
+    }
+}
+
+// The shortest 'digits' * 10^'exponent' that converts back to the positive
+// finite double with representation 'bits', without trailing zeros.
+static void shortestDecimal(unsigned long long bits, unsigned long long& digits, int& exponent)
+{
+    const unsigned long long hiddenBit = 1ull << 52;
+    unsigned long long fraction = bits & (hiddenBit - 1);
+    int biasedExponent = int(bits >> 52);
+
+    if (biasedExponent != 0) {
+        int shift = 1075 - biasedExponent;
+        unsigned long long c = hiddenBit | fraction;
+
+        if (shift > 0 && shift < 53 && ((c >> shift) << shift) == c) {
+            // integral values
+            digits = c >> shift;
+            exponent = 0;
+        } else {
+            schubfach(-shift, c, digits, exponent);
+        }
+    } else if (fraction < 3) {
+        // The algorithm needs at least 3 as significand; the two smallest
+        // subnormals are 5e-324 and 1e-323.
+        digits = fraction == 1 ? 5 : 1;
+        exponent = fraction == 1 ? -324 : -323;
+        return;
+    } else {
+        schubfach(-1074, fraction, digits, exponent);
+    }
+
+    while (digits % 10 == 0) {
+        digits /= 10;
+        exponent++;
+    }
+}
+
+// The product of 'g' and 'cp' divided by 2^95, rounded to odd.
+inline TSIO_ALWAYS_INLINE unsigned roundToOdd(unsigned long long g, unsigned long long cp)
+{
+    unsigned long long x1 = multiplyHigh(g, cp);
+
+    return unsigned(x1 >> 31) | unsigned(((x1 & 0xffffffff) + 0xffffffff) >> 32);
+}
+
+// The float version of schubfach: g is rounded to its high 63 bits and
+// products are rounded to odd in 32 bits.
+static void schubfach(int q, unsigned c, unsigned& digits, int& exponent)
+{
+    const unsigned minSignificand = 1u << 23;
+    unsigned out = c & 1;
+    unsigned long long cb = static_cast<unsigned long long>(c) << 2;
+    unsigned long long cbr = cb + 2;
+    unsigned long long cbl;
+    int k;
+
+    if (c != minSignificand || q == -149) {
+        cbl = cb - 2;
+        k = floorLog10Pow2(q);
+    } else {
+        cbl = cb - 1;
+        k = floorLog10ThreeQuartersPow2(q);
+    }
+
+    int h = q + floorLog2Pow10(-k) + 33;
+    unsigned long long g = scaledPowersOf10[k - minPowerIndex][0] + 1;
+    unsigned vb = roundToOdd(g, cb << h);
+    unsigned vbl = roundToOdd(g, cbl << h);
+    unsigned vbr = roundToOdd(g, cbr << h);
+    unsigned s = vb >> 2;
+
+    if (s >= 10) {
+        unsigned sp10 = s / 10 * 10;
+        unsigned tp10 = sp10 + 10;
+        bool upin = vbl + out <= sp10 << 2;
+        bool wpin = (tp10 << 2) + out <= vbr;
+
+        if (upin != wpin) {
+            digits = upin ? sp10 : tp10;
+            exponent = k;
+            return;
+        }
+    }
+
+    unsigned t = s + 1;
+    bool uin = vbl + out <= s << 2;
+    bool win = (t << 2) + out <= vbr;
+
+    exponent = k;
+
+    if (uin != win) {
+        digits = uin ? s : t;
+    } else {
+        int cmp = int(vb - ((s + t) << 1));
+
+        digits = (cmp < 0 || (cmp == 0 && (s & 1) == 0)) ? s : t;
+    }
+}
+
+// The shortest 'digits' * 10^'exponent' that converts back to the positive
+// finite float with representation 'bits', without trailing zeros.
+static void shortestDecimal(unsigned bits, unsigned& digits, int& exponent)
+{
+    const unsigned hiddenBit = 1u << 23;
+    unsigned fraction = bits & (hiddenBit - 1);
+    int biasedExponent = int(bits >> 23);
+
+    if (biasedExponent != 0) {
+        int shift = 150 - biasedExponent;
+        unsigned c = hiddenBit | fraction;
+
+        if (shift > 0 && shift < 24 && ((c >> shift) << shift) == c) {
+            digits = c >> shift;
+            exponent = 0;
+        } else {
+            schubfach(-shift, c, digits, exponent);
+        }
+    } else if (fraction < 8) {
+        // The algorithm needs at least 8 as significand.
+        static const unsigned char tinyDigits[8] = {0, 1, 3, 4, 6, 7, 8, 1};
+
+        digits = tinyDigits[fraction];
+        exponent = fraction == 7 ? -44 : -45;
+        return;
+    } else {
+        schubfach(-149, fraction, digits, exponent);
+    }
+
+    while (digits % 10 == 0) {
+        digits /= 10;
+        exponent++;
+    }
+}
+
+// Writes "inf" or "nan", padded with spaces.
+static void outputNonFinite(tsioImplementation::Format& format, bool negative, bool isNan, bool up)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    unsigned type = state.type;
+    char sign[1];
+    unsigned signSize = 0;
+
+    if (negative) {
+        sign[signSize++] = '-';
+    } else if (type & plusIfPositive) {
+        sign[signSize++] = '+';
+    } else if (type & spaceIfPositive) {
+        sign[signSize++] = ' ';
+    }
+
+    const char* text = isNan ? (up ? "NAN" : "nan") : (up ? "INF" : "inf");
+
+    if ((type & numericfill) && state.fillCharacter == '0') {
+        type &= ~numericfill;
+    }
+
+    copy(layoutNumber(format, sign, signSize, 3, type & ~precisionGiven), text, 3);
+}
+
+// Writes the decimal digits 'text', the first of which has the weight
+// 10^'decimalExponent', with 'fractionDigits' digits after the decimal point.
+// 'spec' is 'f' for positional notation and 'e' for an exponent.  Digits that
+// are missing at the end are written as zeros.
+static void outputFloatDigits(tsioImplementation::Format& format,
+                              bool negative,
+                              const char* text,
+                              size_t digitCount,
+                              int decimalExponent,
+                              char spec,
+                              size_t fractionDigits)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    unsigned type = state.type;
+    bool alternative = (type & TypeEnum::alternative) != 0;
+    char sign[1];
+    unsigned signSize = 0;
+
+    if (negative) {
+        sign[signSize++] = '-';
+    } else if (type & plusIfPositive) {
+        sign[signSize++] = '+';
+    } else if (type & spaceIfPositive) {
+        sign[signSize++] = ' ';
+    }
+
+    // The result is 'integralCount' digits of 'text' followed by
+    // 'integralZeros' zeros, the decimal point, 'fractionZeros' zeros,
+    // 'fractionCount' digits of 'text', zeros up to 'fractionDigits', and
+    // 'tail'.
+    size_t integralCount;
+    size_t integralZeros = 0;
+    size_t fractionZeros = 0;
+    char tail[7];
+    char* end = tail;
+
+    if (spec == 'f' || spec == 'F') {
+        if (decimalExponent >= 0) {
+            integralCount = std::min(digitCount, size_t(decimalExponent) + 1);
+            integralZeros = size_t(decimalExponent) + 1 - integralCount;
+        } else {
+            integralCount = 0;
+            integralZeros = 1;
+            fractionZeros = std::min(size_t(-decimalExponent - 1), fractionDigits);
+        }
+    } else {
+        integralCount = 1;
+        *end++ = spec;
 
-                while (unsigned(ch - '0') < 9) {
-                    width = width * 10 + (unsigned(ch - '0'));
-                    ch = *(format++);
-                }
-            }
+        if (decimalExponent < 0) {
+            *end++ = '-';
+            decimalExponent = -decimalExponent;
+        } else {
+            *end++ = '+';
         }
-    }
 
-    if (ch == '.') {
-        ch = *(format++);
-        setPrecisionGiven();
+        end = writeDigits(end, unsigned(decimalExponent), std::max(countDigits(unsigned(decimalExponent)), 2u));
+    }
 
-        if (ch == '*') {
-            setPrecisionDynamic();
-            ch = *(format++);
+    size_t fractionCount = std::min(digitCount - integralCount, fractionDigits - fractionZeros);
+    size_t trailingZeros = fractionDigits - fractionZeros - fractionCount;
+    bool point = fractionDigits != 0 || alternative;
+    size_t fractionSize = point + fractionDigits;
+    size_t tailSize = end - tail;
+    size_t integralDigits = integralCount + integralZeros;
+    size_t integralSize = integralDigits;
+    bool isGrouped = (type & grouped) && tailSize == 0;
+    unsigned groupSize = state.groupSize != 0 ? state.groupSize : 3;
+
+    type &= ~precisionGiven;
+
+    if (isGrouped) {
+        integralDigits = groupedZeroCount(state, type, signSize + fractionSize, 0, unsigned(integralDigits), groupSize);
+        integralSize = groupedSize(integralDigits, groupSize);
+    }
 
-            if (unsigned(ch - '0') < 9) {
-                setPositional();
-                precisionPosition = unsigned(ch - '0');
-                ch = *(format++);
+    char* pt = layoutNumber(format, sign, signSize, integralSize + fractionSize + tailSize, type);
 
-                while (unsigned(ch - '0') < 9) {
-                    precisionPosition = precisionPosition * 10 + (unsigned(ch - '0'));
-                    ch = *(format++);
-                }
+    if (isGrouped) {
+        GroupedWriter writer(pt + integralSize, state.groupSeparator, groupSize);
+        size_t i = 0;
 
-                if (ch == '$') {
-                    ch = *(format++);
-                }
-            }
+        for (; i < integralZeros; ++i) {
+            writer.put('0');
         }
-        if (unsigned(ch - '0') < 9) {
-            precision = unsigned(ch - '0');
 
-            ch = *(format++);
+        for (size_t j = integralCount; j != 0; --j, ++i) {
+            writer.put(text[j - 1]);
+        }
 
-            while (unsigned(ch - '0') < 9) {
-                precision = precision * 10 + (unsigned(ch - '0'));
-                ch = *(format++);
-            }
+        for (; i < integralDigits; ++i) {
+            writer.put('0');
         }
+
+        pt += integralSize;
+    } else {
+        pt = copy(pt, text, unsigned(integralCount));
+        pt = fill(pt, '0', unsigned(integralZeros));
     }
 
-    while (ch == 'h' || ch == 'j' || ch == 'l' || ch == 'L' || ch == 't' || ch == 'z') {
-        ch = *(format++);
+    if (point) {
+        *pt++ = '.';
     }
 
-    formatSpecifier = ch;
-    if (ch == 0) {
-        f = format - 1;
-        setSpecial();
-    } else {
-        if (ch == '%' || ch == 'T' || ch == '{' || ch == '}' || ch == 'N') {
-            setSpecial();
-        }
+    pt = fill(pt, '0', unsigned(fractionZeros));
+    pt = copy(pt, text + integralCount, unsigned(fractionCount));
+    pt = fill(pt, '0', unsigned(trailingZeros));
+    copy(pt, tail, unsigned(tailSize));
+}
 
-        f = format;
+// Writes the digits in 'text', the first of weight 10^'decimalExponent', in
+// the notation of 'spec': 'f' writes all digits positionally, 'e' with an
+// exponent and 'g' chooses like %.17g (or %.9g for floats, 'maxDigits') does.
+static void outputShortest(tsioImplementation::Format& format,
+                           bool negative,
+                           const char* text,
+                           size_t digitCount,
+                           int decimalExponent,
+                           char spec,
+                           int maxDigits)
+{
+    if (spec == 'g' || spec == 'G') {
+        bool fixed = decimalExponent >= -4 && decimalExponent < maxDigits;
+
+        spec = fixed ? (spec == 'g' ? 'f' : 'F') : (spec == 'g' ? 'e' : 'E');
+    }
+
+    size_t fractionDigits = digitCount - 1;
+
+    if (spec == 'f' || spec == 'F') {
+        fractionDigits = decimalExponent >= int(digitCount) - 1 ? 0 : size_t(int(digitCount) - 1 - decimalExponent);
     }
+
+    outputFloatDigits(format, negative, text, digitCount, decimalExponent, spec, fractionDigits);
 }
 
-const char* tsioImplementation::FormatState::unParseForFloat(char* buf, bool longDouble) const
+// Writes 'digits' * 10^'exponent' as above.
+static void outputShortest(tsioImplementation::Format& format,
+                           bool negative,
+                           unsigned long long digits,
+                           int exponent,
+                           char spec,
+                           int maxDigits)
 {
-    // the string is built back to front.
-    char* pt = buf + 30;
+    char text[20];
+    unsigned digitCount = countDigits(digits);
+
+    writeDecimal(text + digitCount, digits);
+    outputShortest(format,
+                   negative,
+                   text,
+                   digitCount,
+                   digits == 0 ? 0 : exponent + int(digitCount) - 1,
+                   spec,
+                   maxDigits);
+}
 
-    *pt = 0;
+// Writes a double with the fewest digits that convert back to it.
+static void outputShortest(tsioImplementation::Format& format, double value, char spec)
+{
+    unsigned long long bits;
 
-    *(--pt) = (formatSpecifier == 's') ? 'g' : formatSpecifier;
+    memcpy(&bits, &value, sizeof(bits));
 
-    if (longDouble) {
-        *(--pt) = 'L';
+    bool negative = (bits >> 63) != 0;
+
+    bits &= ~(1ull << 63);
+
+    if (bits >= 0x7ff0000000000000ull) {
+        outputNonFinite(format, negative, bits != 0x7ff0000000000000ull, spec < 'a');
+        return;
     }
 
-    if (precisionGiven()) {
-        if (widthDynamic()) {
-            *(--pt) = '*';
-        } else {
-            unsigned tmp = precision;
+    unsigned long long digits = 0;
+    int exponent = 0;
 
-            do {
-                unsigned q = tmp / 10;
-                unsigned r = tmp - q * 10;
+    if (bits != 0) {
+        shortestDecimal(bits, digits, exponent);
+    }
 
-                *(--pt) = char(r + '0');
-                tmp = q;
-            } while (tmp != 0);
-        }
+    outputShortest(format, negative, digits, exponent, spec, 17);
+}
 
-        *(--pt) = '.';
+// Writes a float with the fewest digits that convert back to it.
+static void outputShortest(tsioImplementation::Format& format, float value, char spec)
+{
+    unsigned bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool negative = (bits >> 31) != 0;
+
+    bits &= ~(1u << 31);
+
+    if (bits >= 0x7f800000u) {
+        outputNonFinite(format, negative, bits != 0x7f800000u, spec < 'a');
+        return;
     }
 
-    // width is defaulted
-    // Only some flags are returned.
+    unsigned digits = 0;
+    int exponent = 0;
 
-    if (type != 0) {
-        if (type & plusIfPositive) {
-            *(--pt) = '+';
-        }
+    if (bits != 0) {
+        shortestDecimal(bits, digits, exponent);
+    }
 
-        if (type & spaceIfPositive) {
-            *(--pt) = ' ';
-        }
+    outputShortest(format, negative, digits, exponent, spec, 9);
+}
 
-        if (type & alternative) {
-            *(--pt) = '#';
-        }
+#ifdef __SIZEOF_INT128__
+inline unsigned bitLength(unsigned __int128 number)
+{
+    unsigned long long high = highBits(number);
+
+    return high != 0 ? 128 - __builtin_clzll(high) : 64 - __builtin_clzll(static_cast<unsigned long long>(number) | 1);
+}
+
+// 10^count for count <= 38.
+inline unsigned __int128 widePowerOf10(unsigned count)
+{
+    return count < 20 ? powersOf10[count] : static_cast<unsigned __int128>(powersOf10[count - 19]) * powersOf10[19];
+}
+
+// number / 2^shift, rounded half to even.
+inline unsigned __int128 shiftRoundEven(unsigned __int128 number, unsigned shift)
+{
+    const unsigned __int128 one = 1;
+
+    if (shift == 0) {
+        return number;
+    } else if (shift >= 128) {
+        return shift == 128 && number > (one << 127);
     }
 
-    *(--pt) = '%';
+    unsigned __int128 quotient = number >> shift;
+    unsigned __int128 remainder = number - (quotient << shift);
+    unsigned __int128 half = one << (shift - 1);
 
-    return pt;
+    return quotient + (remainder > half || (remainder == half && (quotient & 1) != 0));
 }
 
-void tsioImplementation::Format::showErrorContext(FormatNode* node) const
+// number / divisor, rounded half to even; 'divisor' is below 2^127.
+inline unsigned __int128 divideRoundEven(unsigned __int128 number, unsigned __int128 divisor)
 {
-    std::cerr << "         at \"" << wholeFormat << "\"\n";
+    unsigned __int128 quotient = number / divisor;
+    unsigned __int128 remainder = (number - quotient * divisor) * 2;
 
-    size_t offset;
+    return quotient + (remainder > divisor || (remainder == divisor && (quotient & 1) != 0));
+}
 
-    if (node == nullptr) {
-        offset = strlen(wholeFormat);
+// Rounds mantissa * 2^exponent * 10^scale to an integer, if that can be done
+// exactly in 128 bits.
+static bool scaleRoundEven(unsigned long long mantissa, int exponent, int scale, unsigned __int128& result)
+{
+    // 3402 / 1024 is slightly above log2(10)
+    unsigned bits = 64 - __builtin_clzll(mantissa);
+
+    if (scale >= 0) {
+        if (scale > 38 || bits + ((unsigned(scale) * 3402) >> 10) + 1 > 127) {
+            return false;
+        }
+
+        unsigned __int128 number = static_cast<unsigned __int128>(mantissa) * widePowerOf10(unsigned(scale));
+
+        if (exponent < 0) {
+            result = shiftRoundEven(number, unsigned(-exponent));
+        } else if (bitLength(number) + unsigned(exponent) <= 127) {
+            result = number << exponent;
+        } else {
+            return false;
+        }
     } else {
-        offset = node->format - wholeFormat + node->state.prefixSize;
+        if (scale < -38) {
+            return false;
+        }
+
+        unsigned __int128 divisor = widePowerOf10(unsigned(-scale));
+
+        if (exponent >= 0) {
+            if (bits + unsigned(exponent) > 127) {
+                return false;
+            }
+
+            result = divideRoundEven(static_cast<unsigned __int128>(mantissa) << exponent, divisor);
+        } else {
+            if (unsigned(-exponent) + ((unsigned(-scale) * 3402) >> 10) + 1 > 127) {
+                return false;
+            }
+
+            result = divideRoundEven(mantissa, divisor << -exponent);
+        }
     }
 
-    std::cerr << std::setw(offset + 12 + 2) << '^' << std::endl;
+    return true;
 }
 
-tsioImplementation::FormatNode* tsioImplementation::Format::getNode()
+// Writes the digits of 'number' to 'text'; returns the number of digits.
+static unsigned writeWide(char* text, unsigned __int128 number)
 {
-    if (chuncks->index == chuncks->chunckSize - 1) {
-        auto pt = new FormatNodes;
+    unsigned long long parts[2] = {};
+    unsigned partCount = splitDecimal(number, parts);
+    auto rest = static_cast<unsigned long long>(number);
+    unsigned digitCount = countDigits(rest);
 
-        pt->next = chuncks;
-        chuncks = pt;
+    writeDecimal(text + digitCount, rest);
+
+    while (partCount != 0) {
+        digitCount += 19;
+        writeDecimal19(text + digitCount, parts[--partCount]);
     }
 
-    auto result = &chuncks->nodes[chuncks->index++];
-    result->reset();
-    result->format = format;
-    return result;
+    return digitCount;
 }
+#endif
 
-tsioImplementation::FormatNode* tsioImplementation::Format::buildTree(unsigned depth)
+// An unsigned number of arbitrary size in 32 bit limbs, least significant
+// first.  Used for the exact conversion of values outside the range of the
+// 128 bit arithmetic.
+struct BigNumber
 {
+    // (high * 2^64 + low) * 2^shift
+    BigNumber(unsigned long long high, unsigned long long low, unsigned shift)
+        : limbs(shift / 32 + 6)
+    {
+        unsigned offset = shift / 32;
+        unsigned bit = shift % 32;
+        unsigned long long words[4] = {low & 0xffffffff, low >> 32, high & 0xffffffff, high >> 32};
+
+        for (unsigned i = 0; i < 4; ++i) {
+            unsigned long long shifted = words[i] << bit;
+
+            limbs[offset + i] |= unsigned(shifted);
+            limbs[offset + i + 1] |= unsigned(shifted >> 32);
+        }
+    }
 
-    if (*format == 0) {
-        return nullptr;
+    bool isZero() const
+    {
+        for (unsigned limb : limbs) {
+            if (limb != 0) {
+                return false;
+            }
+        }
+
+        return true;
     }
 
-    FormatNode* node = getNode();
-    FormatNode* result = node;
-    FormatNode* next = node;
+    // Divides by 'divisor' and returns the remainder.
+    unsigned divide(unsigned divisor)
+    {
+        unsigned long long remainder = 0;
 
-    for (;;) {
-        auto& state = node->state;
-        const char* fmt = format;
+        for (size_t i = limbs.size(); i-- != 0;) {
+            unsigned long long current = remainder << 32 | limbs[i];
 
-        state.start = fmt;
-        state.prefix = fmt;
-        while (*fmt != 0 && *fmt != '%') {
-            fmt++;
+            limbs[i] = unsigned(current / divisor);
+            remainder = current % divisor;
         }
 
-        if (*fmt == 0) {
-            state.prefixSize = unsigned(fmt - state.prefix);
-            state.setSpecial();
-            state.size = fmt - format;
-            break;
+        return unsigned(remainder);
+    }
+
+    // Multiplies by 'factor'.
+    void multiply(unsigned factor)
+    {
+        unsigned long long carry = 0;
+
+        for (unsigned& limb : limbs) {
+            unsigned long long current = static_cast<unsigned long long>(limb) * factor + carry;
+
+            limb = unsigned(current);
+            carry = current >> 32;
         }
 
-        state.prefixSize = unsigned(fmt - state.prefix);
-        fmt++;
-        state.parse(fmt);
-        state.size = fmt - format;
+        if (carry != 0) {
+            limbs.push_back(unsigned(carry));
+        }
+    }
 
-        if (state.formatSpecifier == 0) {
-            error("Incomplete format");
+    // Multiplies by 10^count.
+    void multiplyPower10(unsigned count)
+    {
+        for (; count >= 9; count -= 9) {
+            multiply(1000000000);
         }
 
-        format = fmt;
-        if (state.positional()) {
-            positional = true;
+        if (count != 0) {
+            multiply(unsigned(powersOf10[count]));
         }
+    }
 
-        auto spec = state.formatSpecifier;
+    // Divides by 2^shift, dropping the bits shifted out.
+    void shiftRight(unsigned shift)
+    {
+        unsigned offset = shift / 32;
+        unsigned bit = shift % 32;
 
-        if (spec == '}' || spec == ']' || spec == '>' || spec == ')') {
-            if (depth == 0) {
-                error(node, "non matching '%", spec, "'");
+        if (offset >= limbs.size()) {
+            std::fill(limbs.begin(), limbs.end(), 0);
+            return;
+        }
+
+        for (size_t i = 0; i < limbs.size(); ++i) {
+            unsigned long long current = 0;
+
+            if (i + offset < limbs.size()) {
+                current = limbs[i + offset];
             }
 
-            break;
+            if (i + offset + 1 < limbs.size()) {
+                current |= static_cast<unsigned long long>(limbs[i + offset + 1]) << 32;
+            }
+
+            limbs[i] = unsigned(current >> bit);
         }
+    }
 
-        if (spec == '{' || spec == '[') {
-            node->child = buildTree(depth + 1);
-        } else if (spec == '<') {
-            bool parentPositional = positional;
+    // Keeps the bits below position 'bits'.
+    void truncate(unsigned bits)
+    {
+        unsigned offset = bits / 32;
 
-            positional = false;
+        if (offset < limbs.size()) {
+            limbs[offset] &= (1u << bits % 32) - 1;
+            std::fill(limbs.begin() + offset + 1, limbs.end(), 0);
+        }
+    }
 
-            node->child = buildTree(depth + 1);
+    void add(const BigNumber& other)
+    {
+        if (limbs.size() < other.limbs.size()) {
+            limbs.resize(other.limbs.size());
+        }
 
-            if (positional) {
-                state.setPositionalChildren();
+        unsigned long long carry = 0;
+
+        for (size_t i = 0; i < limbs.size(); ++i) {
+            carry += limbs[i];
+
+            if (i < other.limbs.size()) {
+                carry += other.limbs[i];
+            } else if (carry == limbs[i]) {
+                return;
             }
 
-            positional = parentPositional;
-        } else if (spec == '(') {
-            bool parentPositional = positional;
+            limbs[i] = unsigned(carry);
+            carry >>= 32;
+        }
 
-            positional = false;
+        if (carry != 0) {
+            limbs.push_back(unsigned(carry));
+        }
+    }
 
-            node->child = buildTree(depth + 1);
+    // Subtracts 'other', which is not larger.
+    void subtract(const BigNumber& other)
+    {
+        long long borrow = 0;
 
-            if (positional) {
-                state.setPositionalChildren();
+        for (size_t i = 0; i < limbs.size(); ++i) {
+            long long current = static_cast<long long>(limbs[i]) - borrow;
+
+            if (i < other.limbs.size()) {
+                current -= other.limbs[i];
+            } else if (borrow == 0) {
+                return;
             }
 
-            positional = parentPositional;
+            borrow = current < 0;
+            limbs[i] = unsigned(current + (borrow << 32));
         }
+    }
 
-        if (*fmt == 0) {
-            break;
+    // -1, 0 or 1 as the number is less than, equal to or greater than 'other'.
+    int compare(const BigNumber& other) const
+    {
+        size_t size = std::max(limbs.size(), other.limbs.size());
+
+        for (size_t i = size; i-- != 0;) {
+            unsigned left = i < limbs.size() ? limbs[i] : 0;
+            unsigned right = i < other.limbs.size() ? other.limbs[i] : 0;
+
+            if (left != right) {
+                return left < right ? -1 : 1;
+            }
         }
 
-        node = getNode();
-        next->next = node;
-        next = node;
+        return 0;
+    }
+
+    // Removes and returns the bits from position 'shift' up (at most 32).
+    unsigned takeHigh(unsigned shift)
+    {
+        unsigned offset = shift / 32;
+        unsigned bit = shift % 32;
+        unsigned long long high = limbs[offset] | static_cast<unsigned long long>(limbs[offset + 1]) << 32;
+        unsigned result = unsigned(high >> bit);
+
+        limbs[offset] &= (1u << bit) - 1;
+        limbs[offset + 1] = 0;
+        return result;
+    }
+
+    // Compares the number with 2^(shift - 1): -1, 0 or 1.
+    int compareHalf(unsigned shift) const
+    {
+        unsigned offset = (shift - 1) / 32;
+        unsigned bit = (shift - 1) % 32;
+
+        if ((limbs[offset] >> bit & 1) == 0) {
+            return -1;
+        } else if ((limbs[offset] & ((1u << bit) - 1)) != 0) {
+            return 1;
+        }
+
+        for (unsigned i = 0; i < offset; ++i) {
+            if (limbs[i] != 0) {
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    std::vector<unsigned> limbs;
+};
+
+// An upper bound of the number of digits exactDigits writes.
+static size_t exactDigitsSize(int exponent, size_t precision)
+{
+    // The integral part is below 2^(exponent + 128); 1233 / 4096 is above log10(2).
+    size_t integralDigits = exponent > -128 ? (size_t(exponent + 128) * 1233 >> 12) + 1 : 0;
+
+    return integralDigits + precision + 20;
+}
+
+// Writes the digits of (high * 2^64 + low) * 2^exponent to 'text', rounded
+// half to even to 'precision' digits after the decimal point ('fixed') or to
+// 'precision' + 1 significant digits, and returns their number.  'text' holds
+// exactDigitsSize() characters.  'decimalExponent' is set to the weight of the
+// first digit, which is not a zero unless the result is 0.
+static size_t exactDigits(unsigned long long high,
+                          unsigned long long low,
+                          int exponent,
+                          bool fixed,
+                          size_t precision,
+                          char* text,
+                          int& decimalExponent)
+{
+    const unsigned chunk = 1000000000;
+    unsigned fractionBits = exponent < 0 ? unsigned(-exponent) : 0;
+    BigNumber integral(high, low, exponent >= 0 ? unsigned(exponent) : 0);
+    BigNumber fraction = integral;
+    std::vector<unsigned> chunks;
+    char* end = text;
+
+    integral.shiftRight(fractionBits);
+    fraction.truncate(fractionBits);
+    fraction.limbs.resize(fractionBits / 32 + 4);
+
+    // the integral part, in chunks of 9 digits from the least significant
+    while (!integral.isZero()) {
+        chunks.push_back(integral.divide(chunk));
+    }
+
+    for (size_t i = chunks.size(); i-- != 0;) {
+        end = writeDigits(end, chunks[i], i + 1 == chunks.size() ? countDigits(chunks[i]) : 9);
+    }
+
+    decimalExponent = int(end - text) - 1;
+
+    if (!fixed && end == text) {
+        // skip the leading zeros of the fraction
+        unsigned next;
+
+        do {
+            fraction.multiply(chunk);
+            next = fraction.takeHigh(fractionBits);
+            decimalExponent -= 9;
+        } while (next == 0);
+
+        unsigned count = countDigits(next);
+
+        end = writeDigits(end, next, count);
+        decimalExponent += count;
+    }
+
+    // Without an integral part, fixed digits start at the first fraction digit.
+    size_t cut = fixed ? size_t(decimalExponent + 1) + precision : precision + 1;
+
+    while (size_t(end - text) <= cut && !fraction.isZero()) {
+        fraction.multiply(chunk);
+        end = writeDigits(end, fraction.takeHigh(fractionBits), 9);
     }
 
-    return result;
-}
+    size_t size = end - text;
+    bool roundUp = false;
 
-void tsioImplementation::Format::tabTo(unsigned column, bool absolute)
-{
-    const char* nlPointer = dest.data() + dest.size();
+    if (size > cut) {
+        char next = text[cut];
+        bool odd = cut != 0 && (text[cut - 1] & 1) != 0;
+        bool sticky = !fraction.isZero() || size_t(std::count(text + cut + 1, end, '0')) != size - cut - 1;
 
-    while (nlPointer > dest.data() && nlPointer[-1] != '\n') {
-        --nlPointer;
+        roundUp = next > '5' || (next == '5' && (sticky || odd));
+        size = cut;
+    } else if (size == cut && fractionBits != 0) {
+        int compare = fraction.compareHalf(fractionBits);
+
+        roundUp = compare > 0 || (compare == 0 && cut != 0 && (text[cut - 1] & 1) != 0);
     }
 
-    size_t currentColumn = dest.data() + dest.size() - nlPointer;
+    if (roundUp) {
+        size_t i = size;
 
-    if (absolute) {
-        column--;
+        while (i != 0 && text[i - 1] == '9') {
+            text[--i] = '0';
+        }
 
-        if (currentColumn < column) {
-            dest.append(column - currentColumn, ' ');
+        if (i != 0) {
+            text[i - 1]++;
         } else {
-            dest.push_back('\n');
-            dest.append(column, ' ');
-        }
-    } else {
-        auto delta = column - (currentColumn % column);
-        if (delta == 0) {
-            delta = column;
+            // a power of 10: a fixed result gets one more digit
+            if (fixed) {
+                text[size++] = '0';
+            }
+
+            text[0] = '1';
+            decimalExponent++;
         }
+    }
 
-        dest.append(delta, ' ');
+    size_t zeros = 0;
+
+    while (zeros < size && text[zeros] == '0') {
+        zeros++;
     }
+
+    if (zeros == size) {
+        text[0] = '0';
+        decimalExponent = 0;
+        return 1;
+    }
+
+    memmove(text, text + zeros, size - zeros);
+    decimalExponent -= int(zeros);
+    return size - zeros;
 }
 
-void tsioImplementation::Format::handleSpecialNodes(FormatNode*& node)
+// Writes (high * 2^64 + mantissa) * 2^exponent with 'precision' digits after
+// the decimal point or, for 'e' and 'g', significant digits, correctly
+// rounded like the C library does.
+static void outputExact(tsioImplementation::Format& format,
+                        bool negative,
+                        unsigned long long high,
+                        unsigned long long mantissa,
+                        int exponent,
+                        char spec,
+                        size_t precision)
 {
-    auto& state = node->state;
-    auto spec = state.formatSpecifier;
+    using namespace tsioImplementation;
 
-    dest.append(state.prefix, state.prefixSize);
+    bool up = spec < 'a';
+    bool general = spec == 'g' || spec == 'G';
+    bool fixed = spec == 'f' || spec == 'F';
 
-    if (spec == 0) {
-        node = node->next;
+    if (general) {
+        precision = precision == 0 ? 0 : precision - 1;
     }
-    if (spec == '%') {
-        dest.push_back('%');
-        node = node->next;
-    } else if (spec == 'T') {
-        tabTo(state.width, state.type & alternative);
-        node = node->next;
-    } else if (spec == 'N') {
-        if (indexStack.empty()) {
-            error("%N format is only valid inside rpeatimg, range and element formats");
-        } else {
-            auto index = indexStack.back();
 
-            if (!(state.type & alternative)) {
-                index++;
+    char buffer[40];
+    const char* text = buffer;
+    size_t digitCount = 0;
+    int decimalExponent = 0;
+    Buffer wide;
+
+    if (high == 0 && mantissa == 0) {
+        buffer[digitCount++] = '0';
+    } else {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 rounded = 0;
+
+        if (fixed) {
+            if (high == 0 && precision <= 38 && scaleRoundEven(mantissa, exponent, int(precision), rounded)) {
+                digitCount = writeWide(buffer, rounded);
+                decimalExponent = int(digitCount) - 1 - int(precision);
+
+                if (rounded == 0) {
+                    decimalExponent = 0;
+                }
             }
+        } else if (high == 0 && precision <= 36) {
+            // The estimate is the exponent of the value or one less.
+            int estimate = floorLog10Pow2(exponent + 63 - __builtin_clzll(mantissa));
+            unsigned __int128 limit = widePowerOf10(unsigned(precision) + 1);
 
-            auto tmpNode = nextNode;
+            for (decimalExponent = estimate; decimalExponent <= estimate + 1; ++decimalExponent) {
+                if (!scaleRoundEven(mantissa, exponent, int(precision) - decimalExponent, rounded)) {
+                    break;
+                } else if (rounded < limit) {
+                    digitCount = writeWide(buffer, rounded);
+                    break;
+                }
+            }
+        }
+#endif
 
-            nextNode = node;
-            outputNumber<10>(*this, index, state.type);
-            nextNode = tmpNode;
+        if (digitCount == 0) {
+            wide.widen(exactDigitsSize(exponent, precision));
+            digitCount = exactDigits(high, mantissa, exponent, fixed, precision, wide.data(), decimalExponent);
+            text = wide.data();
         }
+    }
 
+    if (general) {
+        bool alternative = (format.nextNode->state.type & TypeEnum::alternative) != 0;
 
-        node = node->next;
-    } else if (spec == '{') {
-        auto child = node->child;
+        if (decimalExponent >= -4 && decimalExponent <= int(precision)) {
+            spec = up ? 'F' : 'f';
+            precision = size_t(int(precision) - decimalExponent);
+        } else {
+            spec = up ? 'E' : 'e';
+        }
 
-        if (child == nullptr) {
-            error("Missing format");
-            node = nullptr;
-        } else if (child->next == nullptr && child->state.formatSpecifier == '}') {
-            for (unsigned i = 0, c = state.width; i < c; ++i) {
-                dest.append(child->state.prefix, child->state.prefixSize);
+        if (!alternative) {
+            while (digitCount > 1 && text[digitCount - 1] == '0') {
+                digitCount--;
             }
 
-            node = node->next;
-        } else {
-            pushRepeat(node, state.width);
-            indexStack.push_back(0);
-            node = child;
-        }
-    } else if (spec == '}') {
-        if (!repeatStack.empty()) {
-            auto& element = repeatStack.back();
+            size_t needed = digitCount - 1;
 
-            if ((element.count--) == 0) {
-                node = element.node->next;
-                repeatStack.pop_back();
-                indexStack.pop_back();
-            } else {
-                node = element.node->child;
-                indexStack.back()++;
+            if (spec == 'f' || spec == 'F') {
+                needed = decimalExponent >= int(digitCount) - 1 ? 0 : size_t(int(digitCount) - 1 - decimalExponent);
             }
-        } else {
-            node = node->next;
+
+            precision = std::min(precision, needed);
         }
     }
+
+    outputFloatDigits(format, negative, text, digitCount, decimalExponent, spec, precision);
 }
 
-tsioImplementation::FormatNode* tsioImplementation::Format::getNextSibling(FormatNode* node, bool first)
+static void outputExact(tsioImplementation::Format& format, double value, char spec, size_t precision)
 {
-    if (node == nullptr) {
-        return node;
-    }
+    unsigned long long bits;
 
-    if (!first) {
-        node = node->next;
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool negative = (bits >> 63) != 0;
+
+    bits &= ~(1ull << 63);
+
+    if (bits >= 0x7ff0000000000000ull) {
+        outputNonFinite(format, negative, bits != 0x7ff0000000000000ull, spec < 'a');
+        return;
     }
 
-    while (node != nullptr && node->state.nonDynamicSpecial()) {
-        handleSpecialNodes(node);
+    unsigned long long mantissa = bits & ((1ull << 52) - 1);
+    int exponent = int(bits >> 52);
+
+    if (exponent == 0) {
+        exponent = 1;
+    } else {
+        mantissa |= 1ull << 52;
     }
 
-    return node;
+    outputExact(format, negative, 0, mantissa, exponent - 1075, spec, precision);
 }
 
-std::tuple<char, unsigned> tsioImplementation::Format::getNextSiblingSpecAndType(FormatNode* node)
+static void outputExact(tsioImplementation::Format& format, float value, char spec, size_t precision)
 {
-    if (node != nullptr) {
-        node = node->next;
+    unsigned bits;
 
-        while (node != nullptr && node->state.nonDynamicSpecial()) {
-            node = node->next;
-        }
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool negative = (bits >> 31) != 0;
+
+    bits &= ~(1u << 31);
+
+    if (bits >= 0x7f800000u) {
+        outputNonFinite(format, negative, bits != 0x7f800000u, spec < 'a');
+        return;
     }
 
-    if (node == nullptr) {
-        return { '\0' , 0u };
+    unsigned mantissa = bits & ((1u << 23) - 1);
+    int exponent = int(bits >> 23);
+
+    if (exponent == 0) {
+        exponent = 1;
     } else {
-        return { node->state.formatSpecifier, node->state.type };
+        mantissa |= 1u << 23;
     }
+
+    outputExact(format, negative, 0, mantissa, exponent - 150, spec, precision);
 }
 
-tsioImplementation::FormatNode* tsioImplementation::Format::getChild(FormatNode* node)
+#if LDBL_MANT_DIG == 64 || LDBL_MANT_DIG == 113 || defined(__SIZEOF_FLOAT128__)
+#ifdef __SIZEOF_INT128__
+// The shortest digits of (high * 2^64 + low) * 2^exponent as below, in 128 bit
+// arithmetic.  Returns 0 when the scaled numbers don't fit.
+static size_t shortestDigits128(unsigned long long high,
+                                unsigned long long low,
+                                int exponent,
+                                bool closerBelow,
+                                char* text,
+                                int& decimalExponent)
 {
-    auto child = node->child;
+    unsigned shift = closerBelow ? 2 : 1;
+    unsigned scale = exponent >= 0 ? unsigned(exponent) : 0;
+    unsigned bits = high != 0 ? 128 - __builtin_clzll(high) : 64 - __builtin_clzll(low);
+    int k = floorLog10Pow2(exponent + int(bits) - 1) + 1;
 
-    if (child != nullptr) {
-        auto& state = child->state;
+    // r and plus stay below 10 * s, which must fit after the fixup below.
+    unsigned sBits = (exponent >= 0 ? shift : shift + unsigned(-exponent)) + 1;
 
-        if (state.nonDynamicSpecial()) {
-            return getNextSibling(child, true);
-        }
+    if (k > 0) {
+        sBits += (unsigned(k) * 3402 >> 10) + 1;
     }
 
-    return child;
-}
-
-void tsioImplementation::Format::getNextNode(bool first)
-{
-    if (nextNode == nullptr) {
-        return;
+    if (sBits > 120 || k < -38) {
+        return 0;
     }
 
-    if (!first) {
-        nextNode = nextNode->next;
+    unsigned __int128 r = (static_cast<unsigned __int128>(high) << 64 | low) << (scale + shift);
+    unsigned __int128 s = static_cast<unsigned __int128>(1) << (exponent >= 0 ? shift : shift + unsigned(-exponent));
+    unsigned __int128 minus = static_cast<unsigned __int128>(1) << scale;
+    unsigned __int128 plus = minus << (shift - 1);
+    bool even = (low & 1) == 0;
+
+    if (k >= 0) {
+        s *= widePowerOf10(unsigned(k));
+    } else {
+        unsigned __int128 factor = widePowerOf10(unsigned(-k));
+
+        r *= factor;
+        minus *= factor;
+        plus *= factor;
     }
 
-    while (nextNode != nullptr && nextNode->state.nonDynamicSpecial()) {
-        handleSpecialNodes(nextNode);
+    if (even ? r + plus >= s : r + plus > s) {
+        s *= 10;
+        k++;
     }
-}
 
-void tsioImplementation::Format::printTree(std::ostream& os, FormatNode* node, unsigned indent)
-{
-    const auto& state = node->state;
+    size_t digitCount = 0;
 
-    for (unsigned i = 0; i < indent; ++i) {
-        os << "  ";
-    }
+    for (;;) {
+        unsigned digit = 0;
 
-    os << '"';
-    os.write(state.start, state.size);
-    os << '"';
+        r *= 10;
+        minus *= 10;
+        plus *= 10;
 
-    os << '\n';
+        while (r >= s) {
+            r -= s;
+            digit++;
+        }
 
-    auto child = node->child;
+        bool down = even ? r <= minus : r < minus;
+        bool up = even ? r + plus >= s : r + plus > s;
 
-    while (child != nullptr) {
-        printTree(os, child, indent + 1);
+        if (down && up) {
+            up = 2 * r > s || (2 * r == s && (digit & 1) != 0);
+        }
 
-        child = child->next;
-    }
-}
+        if (down || up) {
+            text[digitCount++] = char('0' + digit + up);
+            decimalExponent = k - 1;
+            return digitCount;
+        }
 
-void tsioImplementation::Format::dump()
-{
-    for (auto node = nextNode; node != 0; node = node->next) {
-        printTree(std::cout, node, 0);
+        text[digitCount++] = char('0' + digit);
     }
 }
-
-void tsio::fmt::initialize(const char* format)
+#endif
+
+// Writes the fewest digits that read back as (high * 2^64 + low) * 2^exponent
+// to 'text', at most 40, and returns their number; 'decimalExponent' is set to
+// the weight of the first digit.  This is the free format algorithm of Steele
+// and White, with the scaling of Burger and Dybvig, for the formats that are
+// too wide for the Schubfach tables.  'closerBelow' tells that the value is a
+// power of 2 whose next smaller neighbour is at half the distance of the next
+// larger one.
+static size_t shortestDigits(unsigned long long high,
+                             unsigned long long low,
+                             int exponent,
+                             bool closerBelow,
+                             char* text,
+                             int& decimalExponent)
 {
-    state.reset();
+#ifdef __SIZEOF_INT128__
+    size_t digitCount = shortestDigits128(high, low, exponent, closerBelow, text, decimalExponent);
 
-    if (format == 0) {
-        return;
+    if (digitCount != 0) {
+        return digitCount;
     }
-
-    if (*format == '%') {
-        format++;
+#else
+    size_t digitCount = 0;
+#endif
+
+    // The value is r / s and the rounding boundaries lie minus / s below and
+    // plus / s above it, all scaled to integers.
+    unsigned shift = closerBelow ? 2 : 1;
+    unsigned scale = exponent >= 0 ? unsigned(exponent) : 0;
+    BigNumber r(high, low, scale + shift);
+    BigNumber s(0, 1, exponent >= 0 ? shift : shift + unsigned(-exponent));
+    BigNumber minus(0, 1, scale);
+    BigNumber plus(0, 1, scale + shift - 1);
+    BigNumber sum(0, 0, 0);
+    unsigned bits = high != 0 ? 128 - __builtin_clzll(high) : 64 - __builtin_clzll(low);
+
+    // With an even significand the boundaries themselves read back as the
+    // value.
+    bool even = (low & 1) == 0;
+
+    // 10^(k - 1) <= value, and the value is below 10^(k + 1).
+    int k = floorLog10Pow2(exponent + int(bits) - 1) + 1;
+
+    if (k >= 0) {
+        s.multiplyPower10(unsigned(k));
+    } else {
+        r.multiplyPower10(unsigned(-k));
+        minus.multiplyPower10(unsigned(-k));
+        plus.multiplyPower10(unsigned(-k));
     }
 
-    state.parse(format);
-}
+    sum = r;
+    sum.add(plus);
 
-void tsioImplementation::printfDetail(Format& format,
-                                      long long sValue,
-                                      unsigned long long uValue,
-                                      bool isSigned)
-{
-    auto& state = format.nextNode->state;
-    char spec = state.formatSpecifier;
+    if (sum.compare(s) >= (even ? 0 : 1)) {
+        s.multiply(10);
+        k++;
+    }
 
-    auto type = state.type;
+    for (;;) {
+        unsigned digit = 0;
 
-    // let's favor the most used formats
-    if (spec == 'd' || spec == 'i') {
-        if (sValue > 0 && (type & (plusIfPositive | spaceIfPositive)) == 0) {
-            outputNumber<10>(format, uValue, type);
-            return;
+        r.multiply(10);
+        minus.multiply(10);
+        plus.multiply(10);
+
+        while (r.compare(s) >= 0) {
+            r.subtract(s);
+            digit++;
         }
 
-        outputNumber<10, true>(format, sValue, type);
-        return;
-    } else if (spec == 'u') {
-        outputNumber<10>(format, uValue, type);
-        return;
-    }
+        sum = r;
+        sum.add(plus);
 
-    switch (spec) {
-        case 'X':
-            outputNumber<16>(format, uValue, type | upcase);
-            return;
+        bool down = r.compare(minus) <= (even ? 0 : -1);
+        bool up = sum.compare(s) >= (even ? 0 : 1);
 
-        case 'B':
-            outputNumber<2>(format, uValue, type | upcase);
-            return;
+        if (down && up) {
+            // both digits read back; take the nearest, or the even one
+            sum = r;
+            sum.add(r);
 
-        case 'C': {
-            char c = char(sValue);
-            Buffer tmp;
+            int half = sum.compare(s);
 
-            makeNice(tmp, &c, 1, state.type & alternative);
+            up = half > 0 || (half == 0 && (digit & 1) != 0);
+        }
 
-            outputString(format,
-                         tmp.data(),
-                         tmp.size(),
-                         state.precisionGiven() ? (state.precision > 0 ? state.precision : 1)
-                                                : std::numeric_limits<int>::max());
-            return;
+        if (down || up || digitCount == 39) {
+            text[digitCount++] = char('0' + digit + up);
+            decimalExponent = k - 1;
+            return digitCount;
         }
 
-        case 'b':
-            outputNumber<2>(format, uValue, type);
-            return;
+        text[digitCount++] = char('0' + digit);
+    }
+}
 
-        case 'c': {
-            char c = char(sValue);
-            outputString(format,
-                         &c,
-                         1,
-                         state.precisionGiven() ? (state.precision > 0 ? state.precision : 1)
-                                                : std::numeric_limits<int>::max());
-            return;
-        }
+// A long double or __float128, as (high * 2^64 + low) * 2^exponent when it
+// is finite.
+struct WideFloat
+{
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+    int exponent = 0;
+    bool negative = false;
+    bool closerBelow = false;
+    bool infinite = false;
+    bool isNan = false;
+};
+
+#if LDBL_MANT_DIG == 113 || defined(__SIZEOF_FLOAT128__)
+// Decomposes an IEEE binary128 value, given as its high and low 64 bits.
+static WideFloat decomposeQuad(unsigned long long high, unsigned long long low)
+{
+    WideFloat result;
+    int biased = int(high >> 48) & 0x7fff;
+
+    result.negative = (high >> 63) != 0;
+    result.high = high & ((1ull << 48) - 1);
+    result.low = low;
+
+    if (biased == 0x7fff) {
+        result.infinite = (result.high | low) == 0;
+        result.isNan = !result.infinite;
+    } else if (biased != 0) {
+        result.closerBelow = (result.high | low) == 0 && biased > 1;
+        result.high |= 1ull << 48;
+    }
 
-        case 'n':
-            format.error("The %n formmat requires a pointer to integral argument");
-            return;
+    result.exponent = (biased == 0 ? 1 : biased) - 16383 - 112;
+    return result;
+}
+#endif
 
-        case 'o':
-            outputNumber<8>(format, uValue, type);
-            return;
+#if LDBL_MANT_DIG == 64
+// x87 extended precision, with an explicit leading significand bit.
+static WideFloat decompose(long double value)
+{
+    WideFloat result;
+    unsigned short signExponent;
 
-        case 's':
-            if (isSigned) {
-                outputNumber<10, true>(format, sValue, type);
-            } else {
-                outputNumber<10>(format, uValue, type);
-            }
+    memcpy(&result.low, &value, sizeof(result.low));
+    memcpy(&signExponent, reinterpret_cast<const char*>(&value) + sizeof(result.low), sizeof(signExponent));
 
-            return;
+    int biased = signExponent & 0x7fff;
 
-        case 'x':
-            outputNumber<16>(format, uValue, type);
-            return;
+    result.negative = (signExponent >> 15) != 0;
+
+    if (biased == 0x7fff) {
+        result.infinite = (result.low << 1) == 0;
+        result.isNan = !result.infinite;
     }
 
-    format.error("Invalid format '", spec, "' for integeral value");
+    result.closerBelow = result.low == 1ull << 63 && biased > 1;
+    result.exponent = (biased == 0 ? 1 : biased) - 16383 - 63;
+    return result;
+}
+#elif LDBL_MANT_DIG == 113
+static WideFloat decompose(long double value)
+{
+    unsigned long long words[2];
+
+    memcpy(words, &value, sizeof(words));
+    return decomposeQuad(words[1], words[0]);
+}
+#endif
+
+#ifdef __SIZEOF_FLOAT128__
+static WideFloat decompose(__float128 value)
+{
+    unsigned long long words[2];
+
+    memcpy(words, &value, sizeof(words));
+    return decomposeQuad(words[1], words[0]);
 }
+#endif
 
-void tsioImplementation::printfDetail(Format& format, const std::string& value)
+// Writes a wide value for 's', 'e', 'f' and 'g'.  'maxDigits' is the number of
+// significant digits that always suffice to read it back.
+static void outputWide(tsioImplementation::Format& format, const WideFloat& value, int maxDigits)
 {
+    using namespace tsioImplementation;
+
     auto& state = format.nextNode->state;
     char spec = state.formatSpecifier;
 
-    switch (spec) {
-        case 's':
-            outputString(format,
-                         value.c_str(),
-                         value.size(),
-                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+    if (value.infinite || value.isNan) {
+        outputNonFinite(format, value.negative, value.isNan, spec < 'a');
+    } else if (spec == 's' ? !state.precisionGiven() : (state.type & shortest) != 0) {
+        char text[40] = "0";
+        size_t digitCount = 1;
+        int decimalExponent = 0;
 
-            break;
+        if (value.high != 0 || value.low != 0) {
+            digitCount = shortestDigits(value.high, value.low, value.exponent, value.closerBelow, text, decimalExponent);
+        }
 
-        case 'S': {
-            Buffer tmp;
+        outputShortest(format,
+                       value.negative,
+                       text,
+                       digitCount,
+                       decimalExponent,
+                       spec == 's' ? 'g' : spec,
+                       maxDigits);
+    } else {
+        outputExact(format,
+                    value.negative,
+                    value.high,
+                    value.low,
+                    value.exponent,
+                    spec == 's' ? 'g' : spec,
+                    state.precisionGiven() ? state.precision : 6);
+    }
+}
+#endif
+
+// Writes leading.fraction * 2^exponent for %a, where 'fraction' holds
+// 'fractionDigits' hexadecimal digits.  A rounded leading digit is not
+// normalized, except that 16 becomes 1 with the exponent raised by 4.
+static void outputHexFloat(tsioImplementation::Format& format,
+                           bool negative,
+                           unsigned leading,
+                           unsigned long long fraction,
+                           unsigned fractionDigits,
+                           int exponent)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    unsigned type = state.type;
+    bool up = state.formatSpecifier == 'A';
+    char prefix[3];
+    unsigned prefixSize = 0;
+
+    if (negative) {
+        prefix[prefixSize++] = '-';
+    } else if (type & plusIfPositive) {
+        prefix[prefixSize++] = '+';
+    } else if (type & spaceIfPositive) {
+        prefix[prefixSize++] = ' ';
+    }
 
-            makeNice(tmp, value.c_str(), value.size(), state.type & alternative);
+    prefix[prefixSize++] = '0';
+    prefix[prefixSize++] = up ? 'X' : 'x';
 
-            outputString(format,
-                         tmp.data(),
-                         tmp.size(),
-                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+    size_t precision;
 
-            break;
+    if (!state.precisionGiven()) {
+        if (fraction == 0) {
+            fractionDigits = 0;
+        } else {
+            unsigned zeros = __builtin_ctzll(fraction) / 4;
+
+            fraction >>= 4 * zeros;
+            fractionDigits -= zeros;
         }
 
-        default:
-            for (const auto& v : value) {
-                printfDetail(format, v);
+        precision = fractionDigits;
+    } else {
+        precision = state.precision;
+
+        if (precision < fractionDigits) {
+            // round half to even on the last remaining digit
+            unsigned dropped = 4 * (fractionDigits - unsigned(precision));
+            unsigned long long rest = fraction & ((1ull << dropped) - 1);
+            unsigned long long half = 1ull << (dropped - 1);
+
+            fraction >>= dropped;
+            fractionDigits = unsigned(precision);
+
+            if (rest > half || (rest == half && ((precision == 0 ? leading : unsigned(fraction)) & 1) != 0)) {
+                if (++fraction >> (4 * precision) != 0) {
+                    fraction = 0;
+
+                    if (++leading == 16) {
+                        leading = 1;
+                        exponent += 4;
+                    }
+                }
             }
+        }
     }
-}
 
-void tsioImplementation::printfDetail(Format& format, const char* value)
-{
-    auto& state = format.nextNode->state;
-    char spec = state.formatSpecifier;
-    uintptr_t pValue = uintptr_t(value);
+    char tail[8];
+    char* end = tail;
+    unsigned magnitude = exponent < 0 ? unsigned(-exponent) : unsigned(exponent);
+    unsigned exponentDigits = countDigits(magnitude);
 
-    switch (spec) {
-        case 'p':
-            outputPointer(format, pValue);
+    *end++ = up ? 'P' : 'p';
+    *end++ = exponent < 0 ? '-' : '+';
+    writeDecimal(end + exponentDigits, magnitude);
+    end += exponentDigits;
 
-            break;
+    bool point = precision != 0 || (type & alternative);
+    size_t tailSize = end - tail;
+    char* pt = layoutNumber(format, prefix, prefixSize, 1 + point + precision + tailSize, type & ~precisionGiven);
+    const char* hexDigits = up ? "0123456789ABCDEF" : "0123456789abcdef";
 
-        case 's':
-            outputString(format,
-                         value,
-                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+    *pt++ = hexDigits[leading];
 
-            break;
+    if (point) {
+        *pt++ = '.';
+    }
 
-        case 'S': {
-            Buffer tmp;
+    if (fractionDigits != 0) {
+        char digits[16];
 
-            makeNice(tmp, value, strlen(value), state.type & alternative);
+        writeHex16(digits, fraction << (64 - 4 * fractionDigits), up);
+        pt = copy(pt, digits, fractionDigits);
+    }
 
-            outputString(format,
-                         tmp.data(),
-                         tmp.size(),
-                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+    pt = fill(pt, '0', unsigned(precision - fractionDigits));
+    copy(pt, tail, unsigned(tailSize));
+}
 
-            break;
-        }
+static void outputHexFloat(tsioImplementation::Format& format, double value)
+{
+    unsigned long long bits;
 
-        default:
-            while (*value != 0) {
-                printfDetail(format, *(value++));
-            }
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool negative = (bits >> 63) != 0;
+    unsigned long long fraction = bits & ((1ull << 52) - 1);
+    int exponent = int(bits >> 52) & 0x7ff;
+
+    if (exponent == 0x7ff) {
+        outputNonFinite(format, negative, fraction != 0, format.nextNode->state.formatSpecifier == 'A');
+    } else if (exponent != 0) {
+        outputHexFloat(format, negative, 1, fraction, 13, exponent - 1023);
+    } else {
+        outputHexFloat(format, negative, 0, fraction, 13, fraction == 0 ? 0 : -1022);
+    }
+}
+
+#if LDBL_MANT_DIG == 64
+// x87 extended precision: the leading digit holds the top 4 bits of the
+// explicit 64 bit significand, as in the C library.
+static void outputHexFloat(tsioImplementation::Format& format, long double value)
+{
+    unsigned long long significand;
+    unsigned short signExponent;
+
+    memcpy(&significand, &value, sizeof(significand));
+    memcpy(&signExponent, reinterpret_cast<const char*>(&value) + sizeof(significand), sizeof(signExponent));
+
+    bool negative = (signExponent >> 15) != 0;
+    int exponent = signExponent & 0x7fff;
+    unsigned leading = unsigned(significand >> 60);
+    unsigned long long fraction = significand & ((1ull << 60) - 1);
+
+    if (exponent == 0x7fff) {
+        outputNonFinite(format,
+                        negative,
+                        (significand << 1) != 0,
+                        format.nextNode->state.formatSpecifier == 'A');
+    } else if (significand == 0) {
+        outputHexFloat(format, negative, 0, 0, 15, 0);
+    } else {
+        outputHexFloat(format, negative, leading, fraction, 15, (exponent == 0 ? 1 : exponent) - 16383 - 3);
     }
 }
+#elif LDBL_MANT_DIG == 53
+static void outputHexFloat(tsioImplementation::Format& format, long double value)
+{
+    outputHexFloat(format, double(value));
+}
+#endif
 
+#if LDBL_MANT_DIG != 64 && LDBL_MANT_DIG != 53
 static void outputFloatTmp(tsioImplementation::Format& format, const tsioImplementation::Buffer& tmp)
 {
     using namespace tsioImplementation;
@@ -1120,7 +4509,7 @@ static void outputFloatTmp(tsioImplementation::Format& format, const tsioImpleme
             fill(pt, fillChar, fillSize);
         } else if (type & centerJustify) {
             size_t offset = fillSize / 2;
-            size_t rest = size - offset;
+            size_t rest = fillSize - offset;
 
             pt = fill(pt, fillChar, offset);
             pt = copy(pt, tmp.data(), tmp.size());
@@ -1150,54 +4539,461 @@ static void outputFloatTmp(tsioImplementation::Format& format, const tsioImpleme
     }
 }
 
+// Formats a long double with the C library, for the representations that
+// are not converted natively.
+static void outputFloatC(tsioImplementation::Format& format, long double value)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    char buf[32];
+    const char* f = state.unParseForFloat(buf, true);
+    Buffer tmp;
+    size_t capacity = tmp.capacity();
+    int s = snprintf(tmp.data(), capacity, f, value);
+
+    if (s < 0) {
+        return;
+    }
+
+    // room for the terminating null, then convert again if it didn't fit
+    tmp.widen(size_t(s) + 1);
+
+    if (size_t(s) >= capacity) {
+        snprintf(tmp.data(), tmp.size(), f, value);
+    }
+
+    tmp.shrink(1);
+    outputFloatTmp(format, tmp);
+}
+#endif
+
 void tsioImplementation::printfDetail(Format& format, double value)
 {
     auto& state = format.nextNode->state;
-    auto& dest = format.dest;
     char spec = state.formatSpecifier;
 
     switch (spec) {
         case 's':
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+            if (spec == 's' ? !state.precisionGiven() : (state.type & shortest) != 0) {
+                outputShortest(format, value, spec == 's' ? 'g' : spec);
+            } else {
+                outputExact(format, value, spec == 's' ? 'g' : spec, state.precisionGiven() ? state.precision : 6);
+            }
+
+            break;
+
         case 'a':
         case 'A':
+            outputHexFloat(format, value);
+
+            break;
+
+        default:
+            format.error("Invalid format '", spec, "' for floating point value");
+    }
+}
+
+void tsioImplementation::printfDetail(Format& format, float value)
+{
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+
+    switch (spec) {
+        case 's':
         case 'e':
         case 'E':
         case 'f':
         case 'F':
         case 'g':
-        case 'G': {
-            char buf[32];
-            const char* f = state.unParseForFloat(buf, false);
-            Buffer tmp;
-            char* pt = tmp.data();
-            size_t capacity = tmp.capacity();
+        case 'G':
+            if (spec == 's' ? !state.precisionGiven() : (state.type & shortest) != 0) {
+                outputShortest(format, value, spec == 's' ? 'g' : spec);
+            } else {
+                outputExact(format, value, spec == 's' ? 'g' : spec, state.precisionGiven() ? state.precision : 6);
+            }
 
-            int s = snprintf(pt, capacity, f, value);
+            break;
 
-            if (s < 0) {
-                return;
+        default:
+            printfDetail(format, double(value));
+    }
+}
+
+// Format a run of floats or doubles with the current node.  Fixed notation
+// with at most 9 decimals and no flags other than '-' is written straight into
+// space reserved for each element: the value is split into a 64 bit integral
+// part and the decimals, rounded half to even.  Other formats and values of
+// 2^64 and up convert one by one, without the per element dispatch.
+template <typename Element>
+static void printfFloatRun(tsioImplementation::Format& format,
+                           const Element* data,
+                           size_t count,
+                           const tsioImplementation::FormatState* separator,
+                           bool lastSeparator)
+{
+    using namespace tsioImplementation;
+
+    auto& state = format.nextNode->state;
+    auto& dest = format.dest;
+    const char* prefix = separator ? state.prefix : nullptr;
+    unsigned prefixSize = separator ? state.prefixSize : 0;
+    const char* separatorText = separator ? separator->prefix : nullptr;
+    unsigned separatorSize = separator ? separator->prefixSize : 0;
+
+#ifdef __SIZEOF_INT128__
+    char spec = state.formatSpecifier;
+    unsigned type = state.type;
+    const unsigned fancy = alfafill | numericfill | centerJustify | plusIfPositive | spaceIfPositive | alternative |
+                           grouped | shortest;
+    unsigned precision = state.precisionGiven() ? state.precision : 6;
+
+    if ((spec == 'f' || spec == 'F') && precision <= 9 && (type & fancy) == 0) {
+        size_t width = state.widthGiven() ? state.width : 0;
+        size_t elementSize = prefixSize + std::max(width, size_t(31)) + separatorSize;
+        bool left = (type & leftJustify) != 0;
+        unsigned scale = unsigned(powersOf10[precision]);
+
+        for (size_t i = 0; i < count; ++i) {
+            // floats convert to doubles exactly
+            double value = data[i];
+            unsigned long long bits;
+
+            memcpy(&bits, &value, sizeof(bits));
+
+            unsigned biased = unsigned(bits >> 52) & 0x7ff;
+
+            if (biased >= 1023 + 64) {
+                dest.append(prefix, prefixSize);
+                printfDetail(format, data[i]);
+
+                if (separator != nullptr && (i + 1 < count || lastSeparator)) {
+                    dest.append(separatorText, separatorSize);
+                }
+
+                continue;
+            }
+
+            unsigned long long mantissa = bits & ((1ull << 52) - 1);
+            unsigned long long integral = 0;
+            unsigned fraction = 0;
+
+            if (biased != 0) {
+                mantissa |= 1ull << 52;
+            } else {
+                biased = 1;
+            }
+
+            // value = mantissa * 2^(biased - 1075).  Values below 2^-32 round to 0.
+            if (biased >= 1075) {
+                integral = mantissa << (biased - 1075);
+            } else if (biased > 1075 - 85) {
+                unsigned shift = 1075 - biased;
+
+                // the bits below the point, aligned at the top of a 64 bit word
+                unsigned long long rest;
+                bool sticky = false;
+
+                if (shift <= 64) {
+                    integral = shift < 64 ? mantissa >> shift : 0;
+                    rest = mantissa << (64 - shift);
+                } else {
+                    rest = mantissa >> (shift - 64);
+                    sticky = (mantissa << (128 - shift)) != 0;
+                }
+
+                unsigned __int128 scaled = static_cast<unsigned __int128>(rest) * scale;
+                unsigned long long remainder = static_cast<unsigned long long>(scaled);
+                unsigned long long half = 1ull << 63;
+
+                fraction = unsigned(scaled >> 64);
+
+                // ties round to an even last digit
+                unsigned long long last = precision != 0 ? fraction : integral;
+
+                if (remainder > half || (remainder == half && (sticky || (last & 1) != 0))) {
+                    fraction++;
+                }
+
+                if (fraction == scale) {
+                    integral++;
+                    fraction = 0;
+                }
+            }
+
+            bool negative = (bits >> 63) != 0;
+            unsigned digitCount = countDigits(integral);
+            size_t size = negative + digitCount + (precision != 0 ? precision + 1 : 0);
+            unsigned padding = width > size ? unsigned(width - size) : 0;
+            size_t start = dest.size();
+
+            dest.widen(elementSize);
+
+            char* pt = copy(dest.data() + start, prefix, prefixSize);
+
+            if (!left) {
+                pt = fill(pt, ' ', padding);
+            }
+
+            *pt = '-';
+            pt += negative + digitCount;
+            writeDecimal(pt, integral);
+
+            if (precision != 0) {
+                // the leading 1 of 10^precision + fraction becomes the point
+                writeDecimal(pt + precision + 1, scale + fraction);
+                *pt = '.';
+                pt += precision + 1;
+            }
+
+            if (left) {
+                pt = fill(pt, ' ', padding);
+            }
+
+            if (i + 1 < count || lastSeparator) {
+                pt = copy(pt, separatorText, separatorSize);
+            }
+
+            dest.shrink(size_t(dest.data() + dest.size() - pt));
+        }
+
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < count; ++i) {
+        dest.append(prefix, prefixSize);
+        printfDetail(format, data[i]);
+
+        if (separator != nullptr && (i + 1 < count || lastSeparator)) {
+            dest.append(separatorText, separatorSize);
+        }
+    }
+}
+
+void tsioImplementation::printfFloats(Format& format,
+                                      const float* data,
+                                      size_t count,
+                                      const FormatState* separator,
+                                      bool lastSeparator)
+{
+    printfFloatRun(format, data, count, separator, lastSeparator);
+}
+
+void tsioImplementation::printfFloats(Format& format,
+                                      const double* data,
+                                      size_t count,
+                                      const FormatState* separator,
+                                      bool lastSeparator)
+{
+    printfFloatRun(format, data, count, separator, lastSeparator);
+}
+
+// Divide 'number' by 10^count, rounding half away from zero.
+static unsigned long long roundDecimal(unsigned long long number, unsigned count)
+{
+    if (count == 0) {
+        return number;
+    } else if (count > 19) {
+        return 0;
+    }
+
+    unsigned long long divisor = powersOf10[count];
+    unsigned long long quotient = number / divisor;
+
+    return quotient + (number - quotient * divisor >= divisor / 2);
+}
+
+void tsioImplementation::printfDetail(Format& format, const tsio::Decimal& value)
+{
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+    unsigned type = state.type;
+    bool alternative = (type & TypeEnum::alternative) != 0;
+    unsigned scale = value.scale;
+
+    switch (spec) {
+        case 'a':
+        case 'A':
+            printfDetail(format, double(value.mantissa) / double(powersOf10[scale > 19 ? 19 : scale]));
+            return;
+
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 's':
+            break;
+
+        default:
+            format.error("Invalid format '", spec, "' for decimal value");
+            return;
+    }
+
+    if (scale > 19) {
+        format.error("Invalid decimal scale ", scale, " (maximum is 19)");
+        return;
+    }
+
+    unsigned long long magnitude = value.mantissa;
+    char sign[1];
+    unsigned signSize = 0;
+
+    if (value.mantissa < 0) {
+        magnitude = 0 - magnitude;
+        sign[signSize++] = '-';
+    } else if (type & plusIfPositive) {
+        sign[signSize++] = '+';
+    } else if (type & spaceIfPositive) {
+        sign[signSize++] = ' ';
+    }
+
+    // The result is the integral part, followed by 'head', 'zeroCount' zeros
+    // and 'tail'.
+    unsigned long long integral;
+    unsigned integralDigits = 1;
+    char head[24];
+    char tail[8];
+    char* pt = head;
+    char* end = tail;
+    unsigned zeroCount = 0;
+    unsigned precision = state.precisionGiven() ? state.precision : 6;
+    unsigned digitCount = magnitude == 0 ? 1 : countDigits(magnitude);
+    int exponent = magnitude == 0 ? 0 : int(digitCount) - 1 - int(scale);
+    bool trim = false;
+
+    if (spec == 's') {
+        precision = state.precisionGiven() ? state.precision : scale;
+        spec = 'f';
+    } else if (spec == 'g' || spec == 'G') {
+        // use the exponent after rounding to 'precision' significant digits
+        int roundedExponent = exponent;
+
+        precision = precision == 0 ? 1 : precision;
+
+        if (digitCount > precision &&
+            roundDecimal(magnitude, digitCount - precision) == powersOf10[precision]) {
+            roundedExponent++;
+        }
+
+        if (roundedExponent < int(precision) && roundedExponent >= -4) {
+            precision = unsigned(int(precision) - 1 - roundedExponent);
+            spec = spec == 'g' ? 'f' : 'F';
+        } else {
+            precision--;
+            spec = spec == 'g' ? 'e' : 'E';
+        }
+
+        trim = !alternative;
+    }
+
+    if (spec == 'f' || spec == 'F') {
+        unsigned long long rounded = magnitude;
+        unsigned fractionSize = scale;
+
+        if (precision >= scale) {
+            zeroCount = precision - scale;
+        } else {
+            rounded = roundDecimal(magnitude, scale - precision);
+            fractionSize = precision;
+        }
+
+        integral = rounded / powersOf10[fractionSize];
+        integralDigits = countDigits(integral);
+
+        if (precision != 0 || alternative) {
+            *pt++ = '.';
+        }
+
+        pt = writeDigits(pt, rounded - integral * powersOf10[fractionSize], fractionSize);
+    } else {
+        unsigned long long rounded = magnitude;
+
+        if (magnitude == 0) {
+            zeroCount = precision;
+        } else if (digitCount > precision + 1) {
+            rounded = roundDecimal(magnitude, digitCount - precision - 1);
+
+            if (rounded == powersOf10[precision + 1]) {
+                rounded /= 10;
+                exponent++;
             }
 
-            tmp.widen(s);
+            digitCount = precision + 1;
+        } else {
+            zeroCount = precision + 1 - digitCount;
+        }
+
+        integral = rounded / powersOf10[digitCount - 1];
+
+        if (precision != 0 || alternative) {
+            *pt++ = '.';
+        }
+
+        pt = writeDigits(pt, rounded - integral * powersOf10[digitCount - 1], digitCount - 1);
+
+        *end++ = spec;
+
+        if (exponent < 0) {
+            *end++ = '-';
+            exponent = -exponent;
+        } else {
+            *end++ = '+';
+        }
+
+        end = writeDigits(end, unsigned(exponent), 2);
+    }
+
+    if (trim && std::find(head, pt, '.') != pt) {
+        zeroCount = 0;
+
+        while (pt[-1] == '0') {
+            pt--;
+        }
+
+        if (pt[-1] == '.') {
+            pt--;
+        }
+    }
+
+    size_t headSize = pt - head;
+    size_t tailSize = end - tail;
+    size_t integralSize = integralDigits;
+    bool isGrouped = (type & grouped) && tailSize == 0;
+    unsigned groupSize = state.groupSize != 0 ? state.groupSize : 3;
+
+    type &= ~precisionGiven;
+
+    if (isGrouped) {
+        integralDigits = groupedZeroCount(state, type, signSize + headSize + zeroCount, 0, integralDigits, groupSize);
+        integralSize = groupedSize(integralDigits, groupSize);
+    }
 
-            if (s > int(capacity)) {
-                pt = dest.data();
-                sprintf(pt, f, value);
-            }
+    pt = layoutNumber(format, sign, signSize, integralSize + headSize + zeroCount + tailSize, type);
 
-            outputFloatTmp(format, tmp);
-        }
+    if (isGrouped) {
+        GroupedWriter writer(pt + integralSize, state.groupSeparator, groupSize);
 
-        break;
+        for (unsigned i = 0; i < integralDigits; ++i, integral /= 10) {
+            writer.put(char('0' + integral % 10));
+        }
 
-        default:
-            format.error("Invalid format '", spec, "' for floating point value");
+        pt += integralSize;
+    } else {
+        pt = writeDigits(pt, integral, integralDigits);
     }
-}
 
-void tsioImplementation::printfDetail(Format& format, float value)
-{
-    printfDetail(format, double(value));
+    pt = copy(pt, head, unsigned(headSize));
+    pt = fill(pt, '0', zeroCount);
+    copy(pt, tail, unsigned(tailSize));
 }
 
 void tsioImplementation::printfDetail(Format& format, char value)
@@ -1222,48 +5018,63 @@ void tsioImplementation::printfDetail(Format& format, char value)
 
 void tsioImplementation::printfDetail(Format& format, long double value)
 {
-    auto& state = format.nextNode->state;
-    auto& dest = format.dest;
-    char spec = state.formatSpecifier;
+    char spec = format.nextNode->state.formatSpecifier;
 
     switch (spec) {
         case 's':
-        case 'a':
-        case 'A':
         case 'e':
         case 'E':
         case 'f':
         case 'F':
         case 'g':
-        case 'G': {
-            char buf[32];
-            const char* f = state.unParseForFloat(buf, true);
-            Buffer tmp;
-            char* pt = tmp.data();
-            size_t capacity = tmp.capacity();
+        case 'G':
+#if LDBL_MANT_DIG == 64 || LDBL_MANT_DIG == 113
+            outputWide(format, decompose(value), std::numeric_limits<long double>::max_digits10);
+#elif LDBL_MANT_DIG == 53
+            printfDetail(format, double(value));
+#else
+            outputFloatC(format, value);
+#endif
 
-            int s = snprintf(pt, capacity, f, value);
+            break;
 
-            if (s < 0) {
-                return;
-            }
+        case 'a':
+        case 'A':
+#if LDBL_MANT_DIG == 64 || LDBL_MANT_DIG == 53
+            outputHexFloat(format, value);
+#else
+            outputFloatC(format, value);
+#endif
 
-            tmp.widen(s);
+            break;
 
-            if (s > int(capacity)) {
-                pt = dest.data();
-                sprintf(pt, f, value);
-            }
+        default:
+            format.error("Invalid format '", spec, "' for floating point value");
+    }
+}
 
-            outputFloatTmp(format, tmp);
-        }
+#ifdef __SIZEOF_FLOAT128__
+void tsioImplementation::printfDetail(Format& format, __float128 value)
+{
+    char spec = format.nextNode->state.formatSpecifier;
+
+    switch (spec) {
+        case 's':
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+            outputWide(format, decompose(value), 36);
 
-        break;
+            break;
 
         default:
             format.error("Invalid format '", spec, "' for floating point value");
     }
 }
+#endif
 
 void tsioImplementation::printfDetail(Format& format, bool value)
 {
@@ -1278,6 +5089,259 @@ void tsioImplementation::printfDetail(Format& format, bool value)
     }
 }
 
+/*
+ * Time formatting.
+ *
+ * Rendering the date and time fields is only done when the second changes.
+ * The result is kept per thread, keyed by the text of the time format, with
+ * the sub second fields left out.  Those are the only fields that are
+ * converted again for every call.
+ */
+
+struct TimeCacheEntry
+{
+    std::string key;
+    long long seconds = 0;
+    std::string text;
+    std::vector<std::pair<size_t, tsioImplementation::FormatState>> fractions;
+};
+
+struct TimeCache
+{
+    static const unsigned size = 4;
+    TimeCacheEntry entries[size];
+    unsigned next = 0;
+};
+
+static thread_local TimeCache timeCache;
+
+static const char* const monthNames[12] = {
+    "January", "February", "March", "April", "May", "June",
+    "July", "August", "September", "October", "November", "December" };
+
+static const char* const dayNames[7] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
+
+static void outputFraction(tsioImplementation::Format& format,
+                           const tsioImplementation::FormatState& state,
+                           unsigned nanoseconds)
+{
+    static const unsigned divisors[10] = {
+        1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+
+    tsioImplementation::FormatNode node;
+    unsigned digits = state.precisionGiven() ? (state.precision < 9 ? state.precision : 9) : 6;
+
+    node.state = state;
+    node.state.precision = digits;
+    node.state.setPrecisionGiven();
+    format.nextNode = &node;
+
+    if (digits != 0) {
+        outputNumber<10>(format, nanoseconds / divisors[digits], node.state.type);
+    } else {
+        outputString(format, "", 0, 0);
+    }
+}
+
+static bool renderTime(tsioImplementation::Format& format,
+                       tsioImplementation::FormatNode* node,
+                       TimeCacheEntry& entry,
+                       long long seconds,
+                       unsigned nanoseconds)
+{
+    using namespace tsioImplementation;
+
+    auto& dest = format.dest;
+    time_t t = time_t(seconds);
+    struct tm tm;
+
+    if (localtime_r(&t, &tm) == nullptr) {
+        format.error(node, "Invalid time value");
+        return false;
+    }
+
+    size_t segmentStart = dest.size();
+
+    entry.text.clear();
+    entry.fractions.clear();
+
+    for (; node != nullptr; node = node->next) {
+        auto& state = node->state;
+        char spec = state.formatSpecifier;
+        unsigned type = state.type & ~alternative;
+
+        dest.append(state.prefix, state.prefixSize);
+
+        if (spec == ')' || spec == 0) {
+            break;
+        }
+
+        if (spec == '%') {
+            dest.push_back('%');
+            continue;
+        }
+
+        if (state.dynamic() || state.positional() || state.special()) {
+            format.error(node, "Invalid format '", spec, "' for time value");
+            return false;
+        }
+
+        format.nextNode = node;
+
+        switch (spec) {
+            case 'y':
+                if (state.type & alternative) {
+                    outputNumber<10>(format, tm.tm_year % 100, type);
+                } else {
+                    outputNumber<10>(format, tm.tm_year + 1900, type);
+                }
+
+                break;
+
+            case 'm':
+                if (state.type & alternative) {
+                    const char* name = monthNames[tm.tm_mon];
+
+                    outputString(format,
+                                 name,
+                                 state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+                } else {
+                    outputNumber<10>(format, tm.tm_mon + 1, type);
+                }
+
+                break;
+
+            case 'd':
+                if (state.type & alternative) {
+                    const char* name = dayNames[tm.tm_wday];
+
+                    outputString(format,
+                                 name,
+                                 state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+                } else {
+                    outputNumber<10>(format, tm.tm_mday, type);
+                }
+
+                break;
+
+            case 'H':
+                outputNumber<10>(format, tm.tm_hour, type);
+                break;
+
+            case 'M':
+                outputNumber<10>(format, tm.tm_min, type);
+                break;
+
+            case 'S':
+                outputNumber<10>(format, tm.tm_sec, type);
+                break;
+
+            case 'f':
+                entry.text.append(dest.data() + segmentStart, dest.size() - segmentStart);
+                entry.fractions.emplace_back(entry.text.size(), state);
+                outputFraction(format, state, nanoseconds);
+                segmentStart = dest.size();
+                break;
+
+            default:
+                format.error(node, "Invalid format '", spec, "' for time value");
+                return false;
+        }
+    }
+
+    entry.text.append(dest.data() + segmentStart, dest.size() - segmentStart);
+    entry.seconds = seconds;
+
+    return true;
+}
+
+static void outputTime(tsioImplementation::Format& format,
+                       tsioImplementation::FormatNode* first,
+                       const char* key,
+                       size_t keySize,
+                       long long seconds,
+                       unsigned nanoseconds)
+{
+    auto& cache = timeCache;
+    auto& dest = format.dest;
+    auto nextNode = format.nextNode;
+
+    for (auto& entry : cache.entries) {
+        if (entry.seconds == seconds && entry.key.size() == keySize &&
+            memcmp(entry.key.data(), key, keySize) == 0) {
+            size_t done = 0;
+
+            for (const auto& fraction : entry.fractions) {
+                dest.append(entry.text.data() + done, fraction.first - done);
+                outputFraction(format, fraction.second, nanoseconds);
+                done = fraction.first;
+            }
+
+            dest.append(entry.text.data() + done, entry.text.size() - done);
+            format.nextNode = nextNode;
+            return;
+        }
+    }
+
+    auto& entry = cache.entries[cache.next];
+
+    entry.key.clear();
+
+    if (renderTime(format, first, entry, seconds, nanoseconds)) {
+        entry.key.assign(key, keySize);
+        cache.next = (cache.next + 1) % cache.size;
+    }
+
+    format.nextNode = nextNode;
+}
+
+void tsioImplementation::printfTime(Format& format, long long seconds, unsigned nanoseconds)
+{
+    auto& state = format.nextNode->state;
+    char spec = state.formatSpecifier;
+
+    if (spec == '(') {
+        auto first = format.nextNode->child;
+
+        if (first == nullptr || first->state.formatSpecifier == ')') {
+            format.error(first, "Missing format");
+            return;
+        }
+
+        auto last = first;
+
+        while (last->next != nullptr) {
+            last = last->next;
+        }
+
+        const char* key = first->state.start;
+
+        outputTime(format, first, key, last->state.start + last->state.size - key, seconds, nanoseconds);
+    } else if (spec == 's') {
+        static const char* defaultFormat = "%y-%02m-%02d %02H:%02M:%02S.%f";
+        static tsio::CFormat cf(defaultFormat);
+        size_t keySize = strlen(defaultFormat);
+        auto first = cf.getFormat().nextNode;
+
+        // width and precision apply to the whole text, as for other strings
+        if (!state.widthGiven() && !state.precisionGiven()) {
+            outputTime(format, first, defaultFormat, keySize, seconds, nanoseconds);
+        } else {
+            Format tmp("");
+
+            tmp.nextNode = format.nextNode;
+            outputTime(tmp, first, defaultFormat, keySize, seconds, nanoseconds);
+            outputString(format,
+                         tmp.dest.data(),
+                         int(tmp.dest.size()),
+                         state.precisionGiven() ? state.precision : std::numeric_limits<int>::max());
+        }
+    } else {
+        format.error("Invalid format '", spec, "' for time value");
+    }
+}
+
 std::ostream& tsio::fmt::operator()(std::ostream& out) const
 {
     using namespace tsioImplementation;
@@ -1389,7 +5453,239 @@ tsio::CFormat::CFormat(const char* f)
     format.nextNode = format.buildTree();
 }
 
+tsio::ConsoleSink::~ConsoleSink()
+{
+    tsio::flush(*this);
+}
+
+void tsio::ConsoleSink::write(const char* data, size_t size)
+{
+    tsioImplementation::writeAll(fd, data, size);
+}
+
+tsio::ConsoleSink& tsio::ConsoleSink::out()
+{
+    static ConsoleSink sink(STDOUT_FILENO);
+
+    return sink;
+}
+
+tsio::ConsoleSink& tsio::ConsoleSink::err()
+{
+    static ConsoleSink sink(STDERR_FILENO);
+
+    return sink;
+}
+
+void tsio::useConsoleSinks(bool enable)
+{
+    std::cout.flush();
+    std::cerr.flush();
+
+    tsioImplementation::consoleSinks.store(enable, std::memory_order_release);
+}
+
+/*
+ * Thread buffering.
+ */
+
+struct ThreadBuffer
+{
+    ~ThreadBuffer()
+    {
+        flush();
+    }
+
+    void write(const char* text, size_t size)
+    {
+        if (stream != nullptr) {
+            stream->write(text, size);
+        } else {
+            sink->write(text, size);
+        }
+    }
+
+    void flush()
+    {
+        if (data.size() != 0) {
+            write(data.data(), data.size());
+            data.clear();
+        }
+    }
+
+    // Flush and forget the target, which is about to be destroyed.
+    void release()
+    {
+        flush();
+        stream = nullptr;
+        sink = nullptr;
+    }
+
+    // Records that do not fit in the buffer are written without a copy.
+    void append(const tsioImplementation::Buffer& record)
+    {
+        if (data.size() + record.size() > threshold) {
+            flush();
+
+            if (record.size() >= threshold) {
+                write(record.data(), record.size());
+                return;
+            }
+        }
+
+        data.append(record.data(), record.size());
+
+        if (flushOnNewline && memchr(record.data(), '\n', record.size()) != nullptr) {
+            flush();
+        }
+    }
+
+    std::ostream* stream = nullptr;
+    tsio::Sink* sink = nullptr;
+    size_t threshold = 0;
+    bool flushOnNewline = false;
+    tsioImplementation::Buffer data;
+};
+
+static thread_local ThreadBuffer threadBuffer;
+
+void tsio::setThreadBuffering(size_t threshold, bool flushOnNewline)
+{
+    auto& buffer = threadBuffer;
+
+    buffer.flush();
+    buffer.threshold = threshold;
+    buffer.flushOnNewline = flushOnNewline;
+}
+
+void tsio::flush()
+{
+    threadBuffer.flush();
+}
+
+void tsio::flush(std::ostream& os)
+{
+    auto& buffer = threadBuffer;
+
+    if (buffer.stream == &os) {
+        buffer.release();
+    }
+}
+
+void tsio::flush(Sink& sink)
+{
+    auto& buffer = threadBuffer;
+
+    if (buffer.sink == &sink) {
+        buffer.release();
+    }
+}
+
+void tsioImplementation::output(std::ostream& os, const Buffer& data)
+{
+    auto& buffer = threadBuffer;
+
+    if (buffer.threshold == 0) {
+        os.write(data.data(), data.size());
+        return;
+    }
+
+    if (buffer.stream != &os) {
+        buffer.flush();
+        buffer.stream = &os;
+        buffer.sink = nullptr;
+    }
+
+    buffer.append(data);
+}
+
+void tsioImplementation::output(tsio::Sink& sink, const Buffer& data)
+{
+    auto& buffer = threadBuffer;
+
+    if (buffer.threshold == 0) {
+        sink.write(data.data(), data.size());
+        return;
+    }
+
+    if (buffer.sink != &sink) {
+        buffer.flush();
+        buffer.stream = nullptr;
+        buffer.sink = &sink;
+    }
+
+    buffer.append(data);
+}
+
+tsio::CFormat::CFormat(const char* f, Limiter& l)
+    : CFormat(f)
+{
+    limiter = &l;
+}
+
 tsio::CFormat::~CFormat()
 {
     free(formatCache);
 }
+
+bool tsio::CFormat::admitLimited()
+{
+    if (!limiter->allow()) {
+        return false;
+    }
+
+    reset();
+
+    auto suppressed = limiter->takeSuppressed();
+
+    if (suppressed != 0) {
+        std::string text;
+
+        sprintf(text, "[%llu suppressed] ", suppressed);
+        format.dest.append(text.data(), text.size());
+    }
+
+    return true;
+}
+
+void tsio::Limiter::setRateLimit(double perSecond, unsigned burst)
+{
+    if (!(perSecond > 0)) {
+        interval.store(0, std::memory_order_relaxed);
+        tolerance.store(0, std::memory_order_relaxed);
+    } else {
+        // Keep interval + tolerance far from overflowing when added to the clock.
+        long long calls = burst > 1 ? burst : 1;
+        long long maxInterval = std::numeric_limits<long long>::max() / 4 / calls;
+        double nanoseconds = 1e9 / perSecond;
+        long long newInterval = nanoseconds < static_cast<double>(maxInterval) ?
+                static_cast<long long>(nanoseconds) : maxInterval;
+
+        interval.store(newInterval, std::memory_order_relaxed);
+        tolerance.store(newInterval * (calls - 1), std::memory_order_relaxed);
+    }
+}
+
+// Generic cell rate algorithm: a token bucket that only needs to keep the
+// time at which the bucket will be full again.
+bool tsio::Limiter::allowRate()
+{
+    long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    long long arrival = theoreticalArrival.load(std::memory_order_relaxed);
+    long long step = interval.load(std::memory_order_relaxed);
+    long long limit = tolerance.load(std::memory_order_relaxed);
+
+    for (;;) {
+        long long start = arrival > now ? arrival : now;
+
+        if (start - now > limit) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (theoreticalArrival.compare_exchange_weak(arrival, start + step, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
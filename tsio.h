@@ -29,7 +29,12 @@
 #ifndef TSIO_H
 #define TSIO_H
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -37,6 +42,9 @@
 #include <limits>
 #include <malloc.h>
 #include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include <tuple>
 #include <type_traits>
 #include <vector>
@@ -66,7 +74,10 @@ enum TypeEnum {
     positional = precisionGiven << 1,
     positionalChildren = positional << 1,
     upcase = positionalChildren << 1,
-    special = upcase << 1
+    special = upcase << 1,
+    grouped = special << 1,
+    shortest = grouped << 1,
+    columns = shortest << 1
 };
 
 using std::begin;
@@ -240,6 +251,11 @@ class Buffer
             mData[mEod++] = value;
         }
 
+        void shrink(size_t count)
+        {
+            mEod -= count;
+        }
+
     private:
         void resize(size_t newSize);
 
@@ -382,6 +398,9 @@ struct FormatState
         prefixSize = 0;
         formatSpecifier = 0;
         fillCharacter = ' ';
+        groupSeparator = ',';
+        groupSize = 0;
+        escape = 0;
     }
 
     const char* start;
@@ -396,6 +415,9 @@ struct FormatState
     unsigned prefixSize;
     char formatSpecifier;
     char fillCharacter;
+    char groupSeparator;
+    unsigned char groupSize;
+    char escape;
 };
 
 struct alignas(16) FormatNode
@@ -547,6 +569,125 @@ class SingleFormat
     private:
         tsioImplementation::FormatState state;
 };
+
+/*
+ * A fixed point decimal number with the value mantissa * 10^-scale, for
+ * example Decimal(123456, 2) for 1234.56.  The scale is at most 19.
+ *
+ * Decimal values are printed with the floating point formats without
+ * converting them to floating point: %f and %F round the value half away
+ * from zero to the precision, %e, %E, %g and %G to the number of
+ * significant digits, and %s prints exactly 'scale' decimals unless a
+ * precision is given.
+ */
+struct Decimal
+{
+    Decimal(long long m, unsigned s)
+        : mantissa(m), scale(s)
+    {
+    }
+
+    long long mantissa;
+    unsigned scale;
+};
+
+// A decimal number with a scale fixed at compile time, e.g. Fixed<2> for
+// amounts in cents.
+template <unsigned Scale>
+struct Fixed
+{
+    static_assert(Scale <= 19, "the scale of a Fixed is at most 19");
+
+    Fixed() = default;
+
+    explicit Fixed(long long m)
+        : mantissa(m)
+    {
+    }
+
+    operator Decimal() const
+    {
+        return Decimal(mantissa, Scale);
+    }
+
+    long long mantissa = 0;
+};
+
+class HexDumpPiece;
+};
+
+namespace tsioImplementation
+{
+struct Format;
+
+// The progress of a hex dump that is printed in pieces.
+struct DumpState
+{
+    unsigned long long offset = 0;
+    std::string pending;
+    std::string previous;
+    bool repeating = false;
+};
+
+void printfDetail(Format& format, const tsio::HexDumpPiece& value);
+};
+
+namespace tsio
+{
+// A piece of a HexDump, printed with '%D'.
+class HexDumpPiece
+{
+    private:
+        friend class HexDump;
+        friend void tsioImplementation::printfDetail(tsioImplementation::Format& format, const HexDumpPiece& value);
+
+        HexDumpPiece(tsioImplementation::DumpState& s, const void* data, size_t count, bool l)
+            : state(&s), bytes(static_cast<const unsigned char*>(data)), size(count), last(l)
+        {
+        }
+
+        tsioImplementation::DumpState* state;
+        const unsigned char* bytes;
+        size_t size;
+        bool last;
+};
+
+/*
+ * A hex dump printed with '%D' in pieces, for data that is read in blocks.
+ * Offsets and the collapsing of repeated lines continue from piece to piece,
+ * and 'end()' prints a partial last line and the offset after the last byte.
+ * Every piece is printed by its own call:
+ *
+ *     tsio::HexDump dump;
+ *
+ *     while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+ *         tsio::oprintf("%D", dump(buffer, count));
+ *     }
+ *
+ *     tsio::oprintf("%D", dump.end());
+ */
+class HexDump
+{
+    public:
+        HexDump() = default;
+
+        HexDump(const HexDump&) = delete;
+        HexDump& operator=(const HexDump&) = delete;
+
+        // The next 'count' bytes of the dump.
+        HexDumpPiece operator()(const void* data, size_t count)
+        {
+            return HexDumpPiece(state, data, count, false);
+        }
+
+        HexDumpPiece end()
+        {
+            return HexDumpPiece(state, nullptr, 0, true);
+        }
+
+    private:
+        tsioImplementation::DumpState state;
+};
 };
 
 namespace tsioImplementation
@@ -689,10 +830,20 @@ struct Format
     Buffer dest;
 };
 
+extern std::atomic<bool> consoleSinks;
+
+void writeAll(int fd, const char* data, size_t size);
 void outputPointer(Format& format, uintptr_t pNumber);
 
+void printfString(Format& format, const char* value, size_t size);
+void printfString(Format& format, const char16_t* value, size_t size);
+void printfString(Format& format, const char32_t* value, size_t size);
+void printfString(Format& format, const wchar_t* value, size_t size);
 void printfDetail(Format& format, const std::string& value);
 void printfDetail(Format& format, const char* value);
+void printfDetail(Format& format, const char16_t* value);
+void printfDetail(Format& format, const char32_t* value);
+void printfDetail(Format& format, const wchar_t* value);
 void printfDetail(Format& format, double value);
 void printfDetail(Format& format, long double value);
 void printfDetail(Format& format, float value);
@@ -701,6 +852,185 @@ void printfDetail(Format& format, char value);
 void printfDetail(Format& format, long long sValue, unsigned long long uValue,
         bool isSigned);
 
+#ifdef __SIZEOF_INT128__
+void printfDetail(Format& format, __int128 value);
+void printfDetail(Format& format, unsigned __int128 value);
+#endif
+
+#ifdef __SIZEOF_FLOAT128__
+void printfDetail(Format& format, __float128 value);
+#endif
+
+void printfDetail(Format& format, const tsio::Decimal& value);
+
+template <unsigned Scale>
+void printfDetail(Format& format, const tsio::Fixed<Scale>& value)
+{
+    printfDetail(format, tsio::Decimal(value));
+}
+
+void printfBits(Format& format, const unsigned long long* words, size_t bitCount, bool indexOrder);
+
+void printfIntegers(Format& format,
+                    const void* data,
+                    size_t count,
+                    unsigned elementSize,
+                    bool isSigned,
+                    const FormatState* separator,
+                    bool lastSeparator);
+
+void printfFloats(Format& format,
+                  const float* data,
+                  size_t count,
+                  const FormatState* separator,
+                  bool lastSeparator);
+
+void printfFloats(Format& format,
+                  const double* data,
+                  size_t count,
+                  const FormatState* separator,
+                  bool lastSeparator);
+
+// Contiguous containers of integers, floats and doubles are formatted by batch
+// kernels.
+template <typename T>
+struct isBatchInteger : std::integral_constant<bool,
+    std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value &&
+    sizeof(T) <= sizeof(long long)> {};
+
+template <typename T>
+struct isBatchElement : std::integral_constant<bool,
+    isBatchInteger<T>::value || std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+template <typename Element>
+typename std::enable_if<isBatchInteger<Element>::value>::type
+printfElements(Format& format,
+               const Element* data,
+               size_t count,
+               const FormatState* separator,
+               bool lastSeparator)
+{
+    printfIntegers(format, data, count, sizeof(Element), std::is_signed<Element>::value, separator, lastSeparator);
+}
+
+inline void printfElements(Format& format,
+                           const float* data,
+                           size_t count,
+                           const FormatState* separator,
+                           bool lastSeparator)
+{
+    printfFloats(format, data, count, separator, lastSeparator);
+}
+
+inline void printfElements(Format& format,
+                           const double* data,
+                           size_t count,
+                           const FormatState* separator,
+                           bool lastSeparator)
+{
+    printfFloats(format, data, count, separator, lastSeparator);
+}
+
+template <typename T>
+struct Contiguous : std::false_type {};
+
+template <typename T, size_t N>
+struct Contiguous<T[N]> : isBatchElement<T>
+{
+    typedef T Element;
+    static const T* data(const T (&value)[N]) { return value; }
+};
+
+template <typename T, size_t N>
+struct Contiguous<std::array<T, N>> : isBatchElement<T>
+{
+    typedef T Element;
+    static const T* data(const std::array<T, N>& value) { return value.data(); }
+};
+
+template <typename T, typename A>
+struct Contiguous<std::vector<T, A>> : isBatchElement<T>
+{
+    typedef T Element;
+    static const T* data(const std::vector<T, A>& value) { return value.data(); }
+};
+
+template <typename T>
+typename std::enable_if<!Contiguous<T>::value, bool>::type
+printfBatch(Format&, const T&, size_t, size_t, const FormatState*, bool)
+{
+    return false;
+}
+
+template <typename T>
+typename std::enable_if<Contiguous<T>::value, bool>::type
+printfBatch(Format& format,
+            const T& value,
+            size_t startIndex,
+            size_t count,
+            const FormatState* separator,
+            bool lastSeparator)
+{
+    printfElements(format, Contiguous<T>::data(value) + startIndex, count, separator, lastSeparator);
+    return true;
+}
+
+void printfHexDump(Format& format, const void* data, size_t size);
+
+// Contiguous containers of bytes print as a hex dump with '%D'.
+template <typename T>
+struct isByte : std::integral_constant<bool,
+    std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value
+#if __cplusplus >= 201703L
+    || std::is_same<T, std::byte>::value
+#endif
+    > {};
+
+template <typename T>
+struct isByteRange : std::false_type {};
+
+template <typename T, size_t N>
+struct isByteRange<T[N]> : isByte<T> {};
+
+template <typename T, size_t N>
+struct isByteRange<std::array<T, N>> : isByte<T> {};
+
+template <typename T, typename A>
+struct isByteRange<std::vector<T, A>> : isByte<T> {};
+
+template <typename T>
+typename std::enable_if<!isByteRange<T>::value, bool>::type
+printfDump(Format&, const T&)
+{
+    return false;
+}
+
+template <typename T>
+typename std::enable_if<isByteRange<T>::value, bool>::type
+printfDump(Format& format, const T& value)
+{
+    printfHexDump(format, Contiguous<T>::data(value), size(value));
+    return true;
+}
+
+void printfTime(Format& format, long long seconds, unsigned nanoseconds);
+
+template <typename Duration>
+void printfDetail(Format& format,
+                  const std::chrono::time_point<std::chrono::system_clock, Duration>& value)
+{
+    auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(value.time_since_epoch()).count();
+    long long seconds = count / 1000000000;
+    long long nanoseconds = count % 1000000000;
+
+    if (nanoseconds < 0) {
+        seconds--;
+        nanoseconds += 1000000000;
+    }
+
+    printfTime(format, seconds, unsigned(nanoseconds));
+}
+
 template <typename T>
 typename std::enable_if<std::is_integral<T>::value>::type
 printfDetail(Format& format, const T& value)
@@ -711,6 +1041,64 @@ printfDetail(Format& format, const T& value)
     printfDetail(format, sValue, uValue, std::is_signed<T>::value);
 }
 
+// UTF-16 and UTF-32 strings are printed as UTF-8
+inline void printfDetail(Format& format, const std::u16string& value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, const std::u32string& value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, const std::wstring& value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, char16_t* value)
+{
+    printfDetail(format, static_cast<const char16_t*>(value));
+}
+
+inline void printfDetail(Format& format, char32_t* value)
+{
+    printfDetail(format, static_cast<const char32_t*>(value));
+}
+
+inline void printfDetail(Format& format, wchar_t* value)
+{
+    printfDetail(format, static_cast<const wchar_t*>(value));
+}
+
+#if __cplusplus >= 201703L
+inline void printfDetail(Format& format, std::string_view value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, std::u16string_view value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, std::u32string_view value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, std::wstring_view value)
+{
+    printfString(format, value.data(), value.size());
+}
+
+inline void printfDetail(Format& format, std::byte value)
+{
+    printfDetail(format, static_cast<unsigned char>(value));
+}
+#endif
+
 template<size_t N>
 void printfDetail(Format& format, const std::array<char, N>& value)
 {
@@ -720,7 +1108,12 @@ void printfDetail(Format& format, const std::array<char, N>& value)
     switch (spec) {
         case 's':
         case 'S':
-            printfDetail(format, value.data());
+            // the text ends at the first null or at the end of the array
+            printfString(format, value.data(), std::find(value.begin(), value.end(), 0) - value.begin());
+            break;
+
+        case 'D':
+            printfHexDump(format, value.data(), N);
             break;
 
         default:
@@ -782,11 +1175,135 @@ typename std::enable_if<(hasBegin<T>::value || std::is_array<T>::value) &&
     !hasFormatter<T>::value>::type
 printfDetail(Format& format, const T& value)
 {
+    if (format.nextNode->state.formatSpecifier == 'D' && printfDump(format, value)) {
+        return;
+    }
+
+    if (printfBatch(format, value, 0, size(value), nullptr, false)) {
+        return;
+    }
+
     for (const auto& v : value) {
         printfDetail(format, v);
     }
 }
 
+// A bitset is printed as one binary or hexadecimal number with all its
+// bits, the highest bit first.
+template <size_t N>
+void printfDetail(Format& format, const std::bitset<N>& value)
+{
+    char spec = format.nextNode->state.formatSpecifier;
+
+    if (spec == 'b' || spec == 'B' || spec == 'x' || spec == 'X' || spec == 's') {
+        const std::bitset<N> mask(~0ull);
+        std::array<unsigned long long, (N + 63) / 64 + 1> words;
+        std::bitset<N> rest = value;
+
+        for (size_t i = 0; i < (N + 63) / 64; ++i) {
+            words[i] = (rest & mask).to_ullong();
+            rest >>= 64;
+        }
+
+        printfBits(format, words.data(), N, false);
+    } else if (N <= 64) {
+        printfDetail(format, value.to_ullong());
+    } else {
+        format.error("Invalid format '", spec, "' for bitset");
+    }
+}
+
+// With a binary or hexadecimal format, a vector<bool> is printed as a
+// string of bits, the first element first.
+template <typename A>
+void printfDetail(Format& format, const std::vector<bool, A>& value)
+{
+    char spec = format.nextNode->state.formatSpecifier;
+
+    if (spec == 'b' || spec == 'B' || spec == 'x' || spec == 'X') {
+        std::vector<unsigned long long> words((value.size() + 63) / 64);
+
+        for (size_t i = 0; i < value.size(); ++i) {
+            words[i / 64] |= static_cast<unsigned long long>(value[i]) << (i % 64);
+        }
+
+        printfBits(format, words.data(), value.size(), true);
+    } else {
+        for (bool v : value) {
+            printfDetail(format, v);
+        }
+    }
+}
+
+// The bits of a bitset as a range of bools, for range formats.
+template <size_t N>
+class BitsetRange
+{
+    public:
+        class iterator
+        {
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef bool value_type;
+                typedef ptrdiff_t difference_type;
+                typedef const bool* pointer;
+                typedef bool reference;
+
+                iterator(const std::bitset<N>& b, size_t i)
+                    : bits(&b), index(i)
+                {
+                }
+
+                bool operator*() const
+                {
+                    return (*bits)[index];
+                }
+
+                iterator& operator++()
+                {
+                    ++index;
+                    return *this;
+                }
+
+                bool operator==(const iterator& other) const
+                {
+                    return index == other.index;
+                }
+
+                bool operator!=(const iterator& other) const
+                {
+                    return index != other.index;
+                }
+
+            private:
+                const std::bitset<N>* bits;
+                size_t index;
+        };
+
+        explicit BitsetRange(const std::bitset<N>& b)
+            : bits(b)
+        {
+        }
+
+        iterator begin() const
+        {
+            return iterator(bits, 0);
+        }
+
+        iterator end() const
+        {
+            return iterator(bits, N);
+        }
+
+        size_t size() const
+        {
+            return N;
+        }
+
+    private:
+        const std::bitset<N>& bits;
+};
+
 template <typename T>
 void customFormat(Format& format, const T& value)
 {
@@ -978,6 +1495,32 @@ rangeDetail(Format& format, const T& value)
         return;
     }
 
+    // A range with a single element format and no special formats is
+    // formatted in one go.
+    auto child = nextNode->child;
+
+    if (child != nullptr && !child->state.special() && !child->state.dynamic() &&
+        child->next != nullptr && !child->next->state.special() &&
+        child->next->state.formatSpecifier == ']' &&
+        child->state.formatSpecifier != '[' && child->state.formatSpecifier != '<') {
+        const auto& separator = child->next->state;
+
+        format.nextNode = child;
+
+        bool done = printfBatch(format,
+                                value,
+                                startIndex,
+                                std::min(count, size(value) - startIndex),
+                                &separator,
+                                !(separator.type & alternative));
+
+        format.nextNode = nextNode;
+
+        if (done) {
+            return;
+        }
+    }
+
     format.indexStack.push_back(startIndex);
 
     auto b = begin(value);
@@ -1034,6 +1577,12 @@ rangeDetail(Format& format, const T& value)
     format.nextNode = nextNode;
 }
 
+template <size_t N>
+void rangeDetail(Format& format, const std::bitset<N>& value)
+{
+    rangeDetail(format, BitsetRange<N>(value));
+}
+
 template<std::size_t I = 0, typename... Tp>
 typename std::enable_if<I == sizeof...(Tp), void>::type
 tupleRangeDetail(Format& format, const std::tuple<Tp...>& value, size_t index, size_t count)
@@ -1609,6 +2158,79 @@ int addSprintf(std::string& dest, const char* f, const Ts&... ts)
 
 namespace tsio
 {
+class Sink
+{
+    public:
+        virtual ~Sink() = default;
+
+        // Called once per formatted record.  Implementations must be able to
+        // accept calls from several threads.
+        virtual void write(const char* data, size_t size) = 0;
+
+        virtual void flush()
+        {
+        }
+};
+
+/*
+ * A sink that writes every record with a single write(2) call on a file
+ * descriptor, bypassing the iostream buffers and locks.  Records from
+ * different threads do not interleave.
+ */
+class ConsoleSink : public Sink
+{
+    public:
+        explicit ConsoleSink(int f)
+            : fd(f)
+        {
+        }
+
+        ~ConsoleSink();
+
+        void write(const char* data, size_t size) override;
+
+        // the sinks for the standard output and standard error.
+        static ConsoleSink& out();
+        static ConsoleSink& err();
+
+    private:
+        int fd;
+};
+
+// Make oprintf and eprintf write to ConsoleSink::out() and ConsoleSink::err()
+// instead of std::cout and std::cerr.  Both streams are flushed first.
+void useConsoleSinks(bool enable = true);
+
+// Let fprintf, oprintf and eprintf collect the output of the calling thread
+// in a thread local buffer.  The buffer is written when it would grow beyond
+// 'threshold' bytes, when output goes to another stream or sink, when a
+// record contains a newline (if 'flushOnNewline' is set), when tsio::flush()
+// is called and when the thread exits.  A threshold of 0 ends buffering.
+//
+// The buffer refers to its stream or sink until it is written.  A thread that
+// buffers output for a stream or sink must call tsio::flush() before that
+// stream or sink is destroyed.  ConsoleSink and RotatingFileSink do this for
+// the thread that destroys them.
+void setThreadBuffering(size_t threshold = 65536, bool flushOnNewline = false);
+
+// Write the output buffered by the calling thread.
+void flush();
+
+// Write the output that the calling thread buffered for 'os' or 'sink', if
+// any, and forget it as a target.  Call this before destroying it.
+void flush(std::ostream& os);
+void flush(Sink& sink);
+};
+
+namespace tsioImplementation
+{
+void output(std::ostream& os, const Buffer& data);
+void output(tsio::Sink& sink, const Buffer& data);
+};
+
+namespace tsio
+{
+
 class fmt
 {
 public:
@@ -1630,10 +2252,69 @@ private:
     tsioImplementation::FormatState state;
 };
 
+/*
+ * A Limiter decides, without locking, which calls of a CFormat are formatted.
+ * Suppressed calls skip all formatting; their number is reported at the
+ * start of the next call that is allowed.  The settings may be changed
+ * while other threads use the limiter; such a thread may briefly see the
+ * new interval with the old burst size.
+ */
+class Limiter
+{
+    public:
+        Limiter() = default;
+
+        Limiter(const Limiter&) = delete;
+        Limiter& operator=(const Limiter&) = delete;
+
+        // Allow only one out of every 'n' calls.
+        void setSampling(unsigned n)
+        {
+            sampling.store(n, std::memory_order_relaxed);
+        }
+
+        // Allow on average 'perSecond' calls per second, with bursts of up to 'burst' calls.
+        // A rate that is not positive removes the limit; very low rates are clamped.
+        void setRateLimit(double perSecond, unsigned burst = 1);
+
+        bool allow()
+        {
+            unsigned n = sampling.load(std::memory_order_relaxed);
+
+            if (n > 1 && calls.fetch_add(1, std::memory_order_relaxed) % n != 0) {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            return interval.load(std::memory_order_relaxed) == 0 || allowRate();
+        }
+
+        // Returns the number of suppressed calls since the previous call.
+        unsigned long long takeSuppressed()
+        {
+            if (suppressed.load(std::memory_order_relaxed) == 0) {
+                return 0;
+            }
+
+            return suppressed.exchange(0, std::memory_order_relaxed);
+        }
+
+    private:
+        bool allowRate();
+
+        std::atomic<unsigned> sampling{0};
+        std::atomic<long long> interval{0};
+        std::atomic<long long> tolerance{0};
+        std::atomic<unsigned long long> calls{0};
+        std::atomic<unsigned long long> suppressed{0};
+        std::atomic<long long> theoreticalArrival{0};
+};
+
 class CFormat
 {
     public:
         CFormat(const char* f);
+        CFormat(const char* f, Limiter& l);
         ~CFormat();
 
         tsioImplementation::Format& getFormat()
@@ -1647,8 +2328,27 @@ class CFormat
             format.errorGiven = false;
         }
 
+        void setLimiter(Limiter* l)
+        {
+            limiter = l;
+        }
+
+        // Resets the format.  Returns false if the call must be suppressed.
+        bool admit()
+        {
+            if (limiter != nullptr) {
+                return admitLimited();
+            }
+
+            reset();
+            return true;
+        }
+
     private:
+        bool admitLimited();
+
         char* formatCache = nullptr;
+        Limiter* limiter = nullptr;
         tsioImplementation::Format format;
 };
 
@@ -1691,7 +2391,20 @@ int fprintf(std::ostream& os, const char* format, const Arguments&... arguments)
     fmt.nextNode = fmt.buildTree();
     int result = addSprintf(fmt, arguments...);
 
-    os.write(fmt.dest.data(), fmt.dest.size());
+    tsioImplementation::output(os, fmt.dest);
+
+    return result;
+}
+
+template <typename... Arguments>
+int fprintf(Sink& sink, const char* format, const Arguments&... arguments)
+{
+    tsioImplementation::Format fmt(format);
+
+    fmt.nextNode = fmt.buildTree();
+    int result = addSprintf(fmt, arguments...);
+
+    tsioImplementation::output(sink, fmt.dest);
 
     return result;
 }
@@ -1699,12 +2412,20 @@ int fprintf(std::ostream& os, const char* format, const Arguments&... arguments)
 template <typename... Arguments>
 int oprintf(const char* format, const Arguments&... arguments)
 {
+    if (tsioImplementation::consoleSinks.load(std::memory_order_relaxed)) {
+        return fprintf(ConsoleSink::out(), format, arguments...);
+    }
+
     return fprintf(std::cout, format, arguments...);
 }
 
 template <typename... Arguments>
 int eprintf(const char* format, const Arguments&... arguments)
 {
+    if (tsioImplementation::consoleSinks.load(std::memory_order_relaxed)) {
+        return fprintf(ConsoleSink::err(), format, arguments...);
+    }
+
     return fprintf(std::cerr, format, arguments...);
 }
 
@@ -1738,24 +2459,47 @@ int sprintf(std::string& dest, CFormat& format, const Arguments&... arguments)
 {
     dest.clear();
 
-    format.reset();
+    if (!format.admit()) {
+        return 0;
+    }
+
     return tsioImplementation::addSprintf(dest, format, arguments...);
 }
 
 template <typename... Arguments>
 int asprintf(std::string& dest, CFormat& format, const Arguments&... arguments)
 {
-    format.reset();
+    if (!format.admit()) {
+        return 0;
+    }
+
     return tsioImplementation::addSprintf(dest, format, arguments...);
 }
 
 template <typename... Arguments>
 int fprintf(std::ostream& os, CFormat& format, const Arguments&... arguments)
 {
-    format.reset();
+    if (!format.admit()) {
+        return 0;
+    }
+
     int result = tsioImplementation::addSprintf(format.getFormat(), arguments...);
 
-    os.write(format.getFormat().dest.data(), format.getFormat().dest.size());
+    tsioImplementation::output(os, format.getFormat().dest);
+
+    return result;
+}
+
+template <typename... Arguments>
+int fprintf(Sink& sink, CFormat& format, const Arguments&... arguments)
+{
+    if (!format.admit()) {
+        return 0;
+    }
+
+    int result = tsioImplementation::addSprintf(format.getFormat(), arguments...);
+
+    tsioImplementation::output(sink, format.getFormat().dest);
 
     return result;
 }
@@ -1763,12 +2507,20 @@ int fprintf(std::ostream& os, CFormat& format, const Arguments&... arguments)
 template <typename... Arguments>
 int oprintf(CFormat& format, const Arguments&... arguments)
 {
+    if (tsioImplementation::consoleSinks.load(std::memory_order_relaxed)) {
+        return fprintf(ConsoleSink::out(), format, arguments...);
+    }
+
     return fprintf(std::cout, format, arguments...);
 }
 
 template <typename... Arguments>
 int eprintf(CFormat& format, const Arguments&... arguments)
 {
+    if (tsioImplementation::consoleSinks.load(std::memory_order_relaxed)) {
+        return fprintf(ConsoleSink::err(), format, arguments...);
+    }
+
     return fprintf(std::cerr, format, arguments...);
 }
 
@@ -1777,8 +2529,9 @@ std::string fstring(CFormat& format, const Arguments&... arguments)
 {
     std::string result;
 
-    format.reset();
-    tsioImplementation::addSprintf(result, format, arguments...);
+    if (format.admit()) {
+        tsioImplementation::addSprintf(result, format, arguments...);
+    }
 
     return result;
 }
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2018, Jacques Van Damme.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "tsioSink.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void showError(const char* what, const std::string& name, int error = errno)
+{
+    std::cerr << "TSIO error: " << what << " '" << name << "': " << strerror(error) << ".\n";
+}
+
+tsio::RotatingFileSink::RotatingFileSink(const std::string& baseName,
+                                         size_t segmentSize,
+                                         unsigned segmentSeconds)
+    : mBaseName(baseName), mSegmentSize(segmentSize), mSegmentSeconds(segmentSeconds)
+{
+    mNextSequence = findLastSequence() + 1;
+    mCurrent = openSegment(mNextSequence);
+
+    if (mCurrent.fd >= 0) {
+        ++mNextSequence;
+    } else {
+        showError("could not open", mCurrent.name, mCurrent.error);
+        mOpenFailed = true;
+    }
+
+    mDeadline = std::chrono::steady_clock::now() + mSegmentSeconds;
+    mPrepare = true;
+    mPreparer = std::thread(&RotatingFileSink::preparer, this);
+    mRetirer = std::thread(&RotatingFileSink::retirer, this);
+}
+
+// The current segment is retired like the others, so it is compressed and
+// counted toward the keep count.
+tsio::RotatingFileSink::~RotatingFileSink()
+{
+    tsio::flush(*this);
+
+    {
+        std::lock_guard<std::mutex> lock(mHelperMutex);
+
+        if (mCurrent.fd >= 0) {
+            mRetired.push_back(mCurrent);
+            mCurrent = Segment();
+        }
+
+        mStop = true;
+    }
+
+    mPrepareWork.notify_one();
+    mRetireWork.notify_one();
+    mPreparer.join();
+    mRetirer.join();
+
+    if (mNext.fd >= 0) {
+        close(mNext.fd);
+        unlink(mNext.name.c_str());
+    }
+}
+
+void tsio::RotatingFileSink::setKeepCount(unsigned count)
+{
+    std::lock_guard<std::mutex> lock(mHelperMutex);
+
+    mKeepCount = count;
+}
+
+void tsio::RotatingFileSink::setCompressCommand(const std::string& command)
+{
+    std::lock_guard<std::mutex> lock(mHelperMutex);
+
+    mCompressCommand = command;
+}
+
+void tsio::RotatingFileSink::write(const char* data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mCurrent.fd < 0) {
+        rotate();
+
+        if (mCurrent.fd < 0) {
+            return;
+        }
+    } else if (mCurrent.size != 0) {
+        if ((mSegmentSize != 0 && mCurrent.size + size > mSegmentSize) ||
+            (mSegmentSeconds.count() != 0 && std::chrono::steady_clock::now() >= mDeadline)) {
+            rotate();
+        }
+    }
+
+    tsioImplementation::writeAll(mCurrent.fd, data, size);
+    mCurrent.size += size;
+}
+
+void tsio::RotatingFileSink::flush()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mCurrent.fd >= 0) {
+        fdatasync(mCurrent.fd);
+    }
+}
+
+std::string tsio::RotatingFileSink::currentName() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    return mCurrent.name;
+}
+
+// Called with mMutex held.  Normally the helper thread has the next segment
+// ready, so we only wait when segments are filled faster than they can be created.
+// After a failed open we never wait: the current segment stays in use and
+// the helper is asked to try again once the retry time has passed.
+void tsio::RotatingFileSink::rotate()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    {
+        std::unique_lock<std::mutex> lock(mHelperMutex);
+
+        if (!mOpenFailed) {
+            mReady.wait(lock, [this] { return mNext.fd >= 0 || mNext.sequence != 0; });
+        }
+
+        if (mNext.fd < 0) {
+            if (mNext.sequence == 0 || now < mRetryTime) {
+                return;
+            }
+
+            if (!mOpenFailed) {
+                showError("could not open", mNext.name, mNext.error);
+                mOpenFailed = true;
+            }
+
+            mNextSequence = mNext.sequence;
+            mNext = Segment();
+            mPrepare = true;
+            mRetryTime = now + std::chrono::seconds(1);
+            lock.unlock();
+            mPrepareWork.notify_one();
+            return;
+        }
+
+        mOpenFailed = false;
+        mRetired.push_back(mCurrent);
+        mCurrent = mNext;
+        mNext = Segment();
+        mPrepare = true;
+    }
+
+    mPrepareWork.notify_one();
+    mRetireWork.notify_one();
+    mDeadline = now + mSegmentSeconds;
+}
+
+void tsio::RotatingFileSink::preparer()
+{
+    std::unique_lock<std::mutex> lock(mHelperMutex);
+
+    for (;;) {
+        mPrepareWork.wait(lock, [this] { return mStop || mPrepare; });
+
+        if (mStop) {
+            break;
+        }
+
+        unsigned sequence = mNextSequence++;
+
+        mPrepare = false;
+        lock.unlock();
+
+        Segment segment = openSegment(sequence);
+
+        lock.lock();
+        mNext = segment;
+        mReady.notify_all();
+    }
+}
+
+// Retired segments are handled in order.  After a stop, the queue is
+// emptied before the thread ends.
+void tsio::RotatingFileSink::retirer()
+{
+    std::unique_lock<std::mutex> lock(mHelperMutex);
+
+    for (;;) {
+        mRetireWork.wait(lock, [this] { return mStop || !mRetired.empty(); });
+
+        if (mRetired.empty()) {
+            break;
+        }
+
+        Segment segment = mRetired.front();
+        std::string command = mCompressCommand;
+        unsigned keepCount = mKeepCount;
+
+        mRetired.pop_front();
+        lock.unlock();
+
+        retire(segment, command, keepCount);
+
+        lock.lock();
+    }
+}
+
+// Run 'command' (split at spaces) with 'name' as the last argument, without
+// a shell, and wait for it.
+static bool runCommand(const std::string& command, const std::string& name)
+{
+    std::vector<std::string> words;
+    size_t start = command.find_first_not_of(' ');
+
+    while (start != std::string::npos) {
+        size_t end = command.find(' ', start);
+
+        words.push_back(command.substr(start, end - start));
+        start = command.find_first_not_of(' ', end);
+    }
+
+    words.push_back(name);
+
+    std::vector<char*> arguments;
+
+    for (auto& word : words) {
+        arguments.push_back(&word[0]);
+    }
+
+    arguments.push_back(nullptr);
+
+    pid_t pid;
+
+    if (posix_spawnp(&pid, arguments[0], nullptr, nullptr, arguments.data(), environ) != 0) {
+        return false;
+    }
+
+    int status;
+
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+tsio::RotatingFileSink::Segment tsio::RotatingFileSink::openSegment(unsigned sequence) const
+{
+    Segment segment;
+
+    segment.sequence = sequence;
+    segment.name = fstring("%s.%06u", mBaseName, sequence);
+    segment.fd = open(segment.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+
+    if (segment.fd < 0) {
+        segment.error = errno;
+        return segment;
+    }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    // Reserve the blocks without changing the file size, so O_APPEND writes
+    // start at the beginning of the file.
+    if (mSegmentSize != 0) {
+        fallocate(segment.fd, FALLOC_FL_KEEP_SIZE, 0, mSegmentSize);
+    }
+#endif
+
+    return segment;
+}
+
+void tsio::RotatingFileSink::retire(Segment& segment, const std::string& command, unsigned keepCount) const
+{
+    if (segment.fd < 0) {
+        return;
+    }
+
+#ifdef FALLOC_FL_PUNCH_HOLE
+    // Give back the part of the preallocation that was not used.
+    if (segment.size < mSegmentSize) {
+        fallocate(segment.fd,
+                  FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  segment.size,
+                  mSegmentSize - segment.size);
+    }
+#endif
+
+    close(segment.fd);
+    segment.fd = -1;
+
+    if (command.find_first_not_of(' ') != std::string::npos && !runCommand(command, segment.name)) {
+        showError("could not compress", segment.name);
+    }
+
+    if (keepCount != 0) {
+        removeOld(segment.sequence, keepCount);
+    }
+}
+
+// Retrieve the directory and the file name prefix used for the segments.
+static void splitName(const std::string& baseName, std::string& directory, std::string& prefix)
+{
+    auto slash = baseName.rfind('/');
+
+    if (slash == std::string::npos) {
+        directory = ".";
+        prefix = baseName + '.';
+    } else {
+        directory = (slash == 0) ? "/" : baseName.substr(0, slash);
+        prefix = baseName.substr(slash + 1) + '.';
+    }
+}
+
+// Return the sequence number of a segment name, or 0 if it is not a segment name.
+// Suffixes added by compression programs are ignored.
+static unsigned getSequence(const char* name, const std::string& prefix)
+{
+    if (strncmp(name, prefix.c_str(), prefix.size()) != 0) {
+        return 0;
+    }
+
+    unsigned sequence = 0;
+
+    for (name += prefix.size(); unsigned(*name - '0') < 10; ++name) {
+        sequence = sequence * 10 + unsigned(*name - '0');
+    }
+
+    return (*name == 0 || *name == '.') ? sequence : 0;
+}
+
+unsigned tsio::RotatingFileSink::findLastSequence() const
+{
+    std::string directory;
+    std::string prefix;
+
+    splitName(mBaseName, directory, prefix);
+
+    DIR* dir = opendir(directory.c_str());
+    unsigned result = 0;
+
+    if (dir == nullptr) {
+        return result;
+    }
+
+    while (auto entry = readdir(dir)) {
+        unsigned sequence = getSequence(entry->d_name, prefix);
+
+        if (sequence > result) {
+            result = sequence;
+        }
+    }
+
+    closedir(dir);
+
+    return result;
+}
+
+void tsio::RotatingFileSink::removeOld(unsigned sequence, unsigned keepCount) const
+{
+    if (sequence <= keepCount) {
+        return;
+    }
+
+    std::string directory;
+    std::string prefix;
+
+    splitName(mBaseName, directory, prefix);
+
+    DIR* dir = opendir(directory.c_str());
+
+    if (dir == nullptr) {
+        return;
+    }
+
+    unsigned limit = sequence - keepCount;
+
+    while (auto entry = readdir(dir)) {
+        unsigned s = getSequence(entry->d_name, prefix);
+
+        if (s != 0 && s <= limit) {
+            std::string name = directory + '/' + entry->d_name;
+
+            if (unlink(name.c_str()) != 0) {
+                showError("could not remove", name);
+            }
+        }
+    }
+
+    closedir(dir);
+}
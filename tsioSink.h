@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2018, Jacques Van Damme.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TSIO_SINK_H
+#define TSIO_SINK_H
+
+#include "tsio.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tsio
+{
+/*
+ * A sink that writes to a series of numbered files named <baseName>.000001,
+ * <baseName>.000002, ...  A new file (segment) is started when the current
+ * one would grow beyond 'segmentSize' bytes, or when it is older than
+ * 'segmentSeconds' seconds.  A value of 0 disables the corresponding limit.
+ *
+ * The next segment is always opened and preallocated in advance by a helper
+ * thread, so switching segments only exchanges two file descriptors.
+ * Retired segments are closed, optionally compressed and removed on a second
+ * helper thread, so a slow compression never delays the next segment.  The
+ * last segment is retired the same way when the sink is destroyed.
+ *
+ * If a segment cannot be opened, the failure is reported once and writing
+ * continues in the current segment (if there is none, records are dropped)
+ * while the open is retried every second.
+ */
+class RotatingFileSink : public Sink
+{
+    public:
+        RotatingFileSink(const std::string& baseName, size_t segmentSize, unsigned segmentSeconds = 0);
+        ~RotatingFileSink();
+
+        RotatingFileSink(const RotatingFileSink&) = delete;
+        RotatingFileSink& operator=(const RotatingFileSink&) = delete;
+
+        // Keep at most 'count' retired segments; 0 keeps all of them.
+        void setKeepCount(unsigned count);
+
+        // Run '<command> <segment name>' for every retired segment, e.g. "gzip -f".
+        // The command is split at spaces and run without a shell.
+        void setCompressCommand(const std::string& command);
+
+        void write(const char* data, size_t size) override;
+        void flush() override;
+
+        std::string currentName() const;
+
+    private:
+        struct Segment
+        {
+            int fd = -1;
+            int error = 0;
+            unsigned sequence = 0;
+            size_t size = 0;
+            std::string name;
+        };
+
+        Segment openSegment(unsigned sequence) const;
+        void retire(Segment& segment, const std::string& command, unsigned keepCount) const;
+        void removeOld(unsigned sequence, unsigned keepCount) const;
+        unsigned findLastSequence() const;
+        void rotate();
+        void preparer();
+        void retirer();
+
+        std::string mBaseName;
+        size_t mSegmentSize;
+        std::chrono::seconds mSegmentSeconds;
+
+        // protected by mMutex
+        mutable std::mutex mMutex;
+        Segment mCurrent;
+        std::chrono::steady_clock::time_point mDeadline;
+        std::chrono::steady_clock::time_point mRetryTime;
+        bool mOpenFailed = false;
+
+        // protected by mHelperMutex
+        std::mutex mHelperMutex;
+        std::condition_variable mPrepareWork;
+        std::condition_variable mRetireWork;
+        std::condition_variable mReady;
+        Segment mNext;
+        std::deque<Segment> mRetired;
+        std::string mCompressCommand;
+        unsigned mKeepCount = 0;
+        unsigned mNextSequence = 1;
+        bool mPrepare = false;
+        bool mStop = false;
+
+        std::thread mPreparer;
+        std::thread mRetirer;
+};
+};
+
+#endif